@@ -0,0 +1,340 @@
+#include "Bruinbase.h"
+#include "AsyncIO.h"
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using std::unique_lock;
+using std::mutex;
+
+std::atomic<int> AsyncIO::readCount(0);
+
+// there is no liburing, so the ring is driven with the raw system calls
+static int uringSetup(unsigned entries, struct io_uring_params* params)
+{
+  return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+  return (int)::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+AsyncIO::AsyncIO(bool useUring)
+{
+  ringFd = -1;
+  sqRing = cqRing = NULL;
+  sqes = NULL;
+  sqRingSize = cqRingSize = sqesSize = 0;
+  unsubmitted = inflight = 0;
+  reaping = false;
+  stopping = false;
+
+  if (useUring && setupUring()) {
+    backend = IO_URING;
+    return;
+  }
+
+  backend = THREAD_POOL;
+  for (int i = 0; i < THREAD_COUNT; i++) {
+    workers.push_back(std::thread(&AsyncIO::serve, this));
+  }
+}
+
+AsyncIO::~AsyncIO()
+{
+  if (backend == IO_URING) {
+    ::munmap(sqes, sqesSize);
+    if (cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+    ::munmap(sqRing, sqRingSize);
+    ::close(ringFd);
+    return;
+  }
+
+  {
+    unique_lock<mutex> guard(lock);
+    stopping = true;
+  }
+  workReady.notify_all();
+  for (unsigned i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+AsyncIO& AsyncIO::engine()
+{
+  // never destroyed, so that page files flushed during static
+  // destruction can still use it
+  static AsyncIO* shared = new AsyncIO();
+  return *shared;
+}
+
+AsyncIO::Handle AsyncIO::read(int fd, void* buffer, size_t length, off_t offset)
+{
+  Request req;
+  req.op = OP_READ;
+  req.fd = fd;
+  req.buffer = buffer;
+  req.length = length;
+  req.iov = NULL;
+  req.iovcnt = 0;
+  req.offset = offset;
+  readCount++;
+  return enqueue(req);
+}
+
+AsyncIO::Handle AsyncIO::writev(int fd, const struct iovec* iov, int iovcnt, off_t offset)
+{
+  Request req;
+  req.op = OP_WRITEV;
+  req.fd = fd;
+  req.buffer = NULL;
+  req.length = 0;
+  req.iov = iov;
+  req.iovcnt = iovcnt;
+  req.offset = offset;
+  return enqueue(req);
+}
+
+AsyncIO::Handle AsyncIO::enqueue(const Request& req)
+{
+  unique_lock<mutex> guard(lock);
+
+  // keep the number of outstanding ring entries within the completion
+  // queue, so that no completion is ever dropped
+  if (backend == IO_URING) {
+    while (inflight >= cqEntries) waitUring(guard, -1);
+  }
+
+  Handle handle;
+  if (!freeHandles.empty()) {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+  } else {
+    handle = requests.size();
+    requests.push_back(req);
+  }
+  requests[handle] = req;
+  requests[handle].done = false;
+  requests[handle].result = 0;
+
+  if (backend == THREAD_POOL) {
+    pending.push_back(handle);
+    workReady.notify_one();
+    return handle;
+  }
+
+  // the submission queue is full. hand its entries to the kernel first.
+  if (*sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) submitUring();
+
+  unsigned tail = *sqTail;
+  unsigned index = tail & *sqMask;
+  struct io_uring_sqe* sqe = &sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = req.fd;
+  sqe->off = req.offset;
+  sqe->user_data = handle;
+  if (req.op == OP_READ) {
+    // a one-buffer READV rather than READ, which needs Linux 5.6
+    struct iovec* vec = &requests[handle].vec;
+    vec->iov_base = req.buffer;
+    vec->iov_len = req.length;
+    sqe->opcode = IORING_OP_READV;
+    sqe->addr = (unsigned long)vec;
+    sqe->len = 1;
+  } else {
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->addr = (unsigned long)req.iov;
+    sqe->len = req.iovcnt;
+  }
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  unsubmitted++;
+  inflight++;
+  return handle;
+}
+
+ssize_t AsyncIO::wait(Handle handle)
+{
+  unique_lock<mutex> guard(lock);
+
+  if (handle < 0 || handle >= (int)requests.size()) return RC_INVALID_ATTRIBUTE;
+
+  if (backend == IO_URING) {
+    waitUring(guard, handle);
+  } else {
+    while (!requests[handle].done) completed.wait(guard);
+  }
+
+  return finish(handle);
+}
+
+ssize_t AsyncIO::finish(Handle handle)
+{
+  Request& req = requests[handle];
+  freeHandles.push_back(handle);
+
+  if (req.result >= 0) return req.result;
+  return (req.op == OP_READ) ? RC_FILE_READ_FAILED : RC_FILE_WRITE_FAILED;
+}
+
+//
+// io_uring backend
+//
+
+bool AsyncIO::setupUring()
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ringFd = uringSetup(QUEUE_DEPTH, &params);
+  if (ringFd < 0) { ringFd = -1; return false; }
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+    cqRingSize = sqRingSize;
+  }
+
+  sqRing = ::mmap(NULL, sqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                  ringFd, IORING_OFF_SQ_RING);
+  if (sqRing == MAP_FAILED) { ::close(ringFd); ringFd = -1; return false; }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cqRing = sqRing;
+  } else {
+    cqRing = ::mmap(NULL, cqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                    ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED) {
+      ::munmap(sqRing, sqRingSize);
+      ::close(ringFd);
+      ringFd = -1;
+      return false;
+    }
+  }
+
+  sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* addr = ::mmap(NULL, sqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                      ringFd, IORING_OFF_SQES);
+  if (addr == MAP_FAILED) {
+    if (cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+    ::munmap(sqRing, sqRingSize);
+    ::close(ringFd);
+    ringFd = -1;
+    return false;
+  }
+  sqes = (struct io_uring_sqe*)addr;
+
+  char* sq = (char*)sqRing;
+  sqHead  = (unsigned*)(sq + params.sq_off.head);
+  sqTail  = (unsigned*)(sq + params.sq_off.tail);
+  sqMask  = (unsigned*)(sq + params.sq_off.ring_mask);
+  sqArray = (unsigned*)(sq + params.sq_off.array);
+  sqEntries = params.sq_entries;
+
+  char* cq = (char*)cqRing;
+  cqHead = (unsigned*)(cq + params.cq_off.head);
+  cqTail = (unsigned*)(cq + params.cq_off.tail);
+  cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+  cqes   = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  cqEntries = params.cq_entries;
+
+  return true;
+}
+
+void AsyncIO::submitUring()
+{
+  while (unsubmitted > 0) {
+    int n = uringEnter(ringFd, unsubmitted, 0, 0);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        if (!reaping) reapUring();
+        continue;
+      }
+      // the ring is unusable. fail every request that has not completed.
+      for (unsigned i = 0; i < requests.size(); i++) {
+        if (!requests[i].done) { requests[i].result = -errno; requests[i].done = true; }
+      }
+      unsubmitted = inflight = 0;
+      completed.notify_all();
+      return;
+    }
+    unsubmitted -= n;
+  }
+}
+
+void AsyncIO::reapUring()
+{
+  unsigned head = *cqHead;
+  unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+  if (head == tail) return;
+  for (; head != tail; head++) {
+    struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+    Request& req = requests[cqe->user_data];
+    req.result = cqe->res;
+    req.done = true;
+    inflight--;
+  }
+  __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  completed.notify_all();
+}
+
+void AsyncIO::waitUring(unique_lock<mutex>& guard, Handle handle)
+{
+  // handle -1 waits until any completion frees a ring entry
+  unsigned before = inflight;
+
+  submitUring();
+  for (;;) {
+    // only one thread blocks in the kernel and reaps the completions.
+    // the others wait for it, so that no completion the blocked thread
+    // waits for is taken from under it.
+    if (!reaping) reapUring();
+    if (handle >= 0 ? requests[handle].done : inflight < before || inflight == 0) return;
+    if (reaping) { completed.wait(guard); continue; }
+
+    reaping = true;
+    guard.unlock();
+    uringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+    guard.lock();
+    reaping = false;
+    completed.notify_all();
+  }
+}
+
+//
+// thread pool backend
+//
+
+void AsyncIO::serve()
+{
+  unique_lock<mutex> guard(lock);
+
+  for (;;) {
+    while (pending.empty() && !stopping) workReady.wait(guard);
+    if (pending.empty()) return;
+
+    Handle handle = pending.front();
+    pending.pop_front();
+    Request req = requests[handle];
+
+    // do the I/O without holding the lock
+    guard.unlock();
+    ssize_t n;
+    if (req.op == OP_READ) {
+      n = ::pread(req.fd, req.buffer, req.length, req.offset);
+    } else {
+      n = ::pwritev(req.fd, req.iov, req.iovcnt, req.offset);
+    }
+    if (n < 0) n = -errno;
+    guard.lock();
+
+    requests[handle].result = n;
+    requests[handle].done = true;
+    completed.notify_all();
+  }
+}
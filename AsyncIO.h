@@ -0,0 +1,147 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "Bruinbase.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * an asynchronous I/O engine. reads and writes are started with read()
+ * and writev(), which return at once with a handle, and many of them can
+ * be in flight together. wait() blocks until the request of a handle is
+ * complete and returns its result.
+ *
+ * requests go through io_uring when the kernel allows it. otherwise they
+ * are served by a small pool of threads issuing pread/pwritev calls.
+ * the engine is safe to use from several threads at once.
+ */
+class AsyncIO {
+ public:
+  typedef int Handle;
+
+  enum Backend { IO_URING, THREAD_POOL };
+
+  static const int QUEUE_DEPTH = 128;   // # of io_uring submission entries
+  static const int THREAD_COUNT = 4;    // # of threads of the fallback pool
+
+  /**
+   * create an engine.
+   * @param useUring[IN] try io_uring first. if false or if io_uring
+   *                     cannot be set up, a thread pool is used.
+   */
+  AsyncIO(bool useUring = true);
+  ~AsyncIO();
+
+  /**
+   * @return the engine shared by all page files
+   */
+  static AsyncIO& engine();
+
+  /**
+   * start reading length bytes at offset of the file fd into buffer.
+   * the buffer must stay valid until the request is waited for.
+   * @return the handle of the request, or an error code
+   */
+  Handle read(int fd, void* buffer, size_t length, off_t offset);
+
+  /**
+   * start writing the iovcnt buffers of iov at offset of the file fd.
+   * iov and its buffers must stay valid until the request is waited for.
+   * @return the handle of the request, or an error code
+   */
+  Handle writev(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+
+  /**
+   * wait for the request of handle to complete. every handle must be
+   * waited for exactly once.
+   * @param handle[IN] the handle returned by read() or writev()
+   * @return # of bytes transferred, or an error code
+   */
+  ssize_t wait(Handle handle);
+
+  /**
+   * @return the backend serving the requests
+   */
+  Backend getBackend() const { return backend; }
+
+  /**
+   * @return the total # of reads started through any engine
+   */
+  static int getReadCount() { return readCount; }
+
+ private:
+  enum { OP_READ, OP_WRITEV };
+
+  struct Request {
+    int    op;            // OP_READ or OP_WRITEV
+    int    fd;
+    void*  buffer;        // OP_READ: the destination buffer
+    size_t length;        // OP_READ: # of bytes to read
+    const struct iovec* iov;  // OP_WRITEV: the source buffers
+    int    iovcnt;
+    struct iovec vec;     // OP_READ on the ring: buffer and length
+    off_t  offset;
+    bool   done;          // true once the result is set
+    ssize_t result;       // # of bytes transferred or -errno
+  };
+
+  AsyncIO(const AsyncIO&);
+  AsyncIO& operator=(const AsyncIO&);
+
+  Handle  enqueue(const Request& req);
+  ssize_t finish(Handle handle);
+
+  // io_uring backend
+  bool setupUring();
+  void submitUring();
+  void reapUring();
+  void waitUring(std::unique_lock<std::mutex>& guard, Handle handle);
+
+  // thread pool backend
+  void serve();
+
+  Backend backend;
+
+  std::mutex lock;                      // protects everything below
+  std::condition_variable completed;    // signalled when requests complete
+  std::deque<Request>  requests;        // indexed by handle. growing it
+                                        // does not move a request, so the
+                                        // kernel can read its vec
+  std::vector<Handle>  freeHandles;
+
+  // io_uring state
+  int      ringFd;
+  void*    sqRing;
+  size_t   sqRingSize;
+  void*    cqRing;
+  size_t   cqRingSize;
+  struct io_uring_sqe* sqes;
+  size_t   sqesSize;
+  unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+  unsigned *cqHead, *cqTail, *cqMask;
+  struct io_uring_cqe* cqes;
+  unsigned sqEntries;
+  unsigned cqEntries;
+  unsigned unsubmitted;   // # of entries queued but not yet submitted
+  unsigned inflight;      // # of entries whose completion is not reaped
+  bool     reaping;       // true while a thread waits in io_uring_enter
+
+  // thread pool state
+  std::deque<Handle> pending;           // requests waiting for a thread
+  std::condition_variable workReady;
+  std::vector<std::thread> workers;
+  bool stopping;
+
+  static std::atomic<int> readCount;  // total # of reads started
+};
+
+#endif // ASYNCIO_H
@@ -11,11 +11,16 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstring> 
+#include <climits>
+#include <vector>
+#include <algorithm>
 #include "BTreeIndex.h"
 #include "BTreeNode.h"
 
 using namespace std;
 
+int BTreeIndex::fillFactor=BTreeIndex::DEFAULT_FILL_FACTOR;
+
 /*
  * BTreeIndex constructor
  */
@@ -25,43 +30,72 @@ BTreeIndex::BTreeIndex()
     rootPid = 0;
     //no root yet so height=0
     treeHeight=0;
+    entryCount=0;
 }
 
 /*
  * Open the index file in read or write mode.
  * Under 'w' mode, the index file should be created if it does not exist.
  * @param indexname[IN] the name of the index file
- * @param mode[IN] 'r' for read, 'w' for write
+ * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
  * @return error code. 0 if no error
  */
 RC BTreeIndex::open(const string& indexname, char mode)
 {
-    //buffer to store stuff
-
-    char buffer[PageFile::PAGE_SIZE];
-    memset(buffer, '\0', PageFile::PAGE_SIZE);
-    
     //error variable
     RC rc=pf.open(indexname,mode);
     //check for error
     if(rc)
         return rc;
+
+    //buffer to store stuff, as large as a page of the file
+    vector<char> buffer(pf.getPageSize(),'\0');
  
     //first
     if(pf.endPid()<=0)
     {
         rootPid=0;
         treeHeight=0;
+        entryCount=0;
     }
     else//rest
     {
-        rc=pf.read(0, buffer);
+        rc=pf.read(0, &buffer[0]);
+
+        //the root is treeHeight-1 levels above the leaves
+        int level;
+        if(!rc)
+            rc=readNodeLevel(&buffer[0],level);
 
         //check for error
         if(rc)
+        {
+            pf.close();
             return rc;
+        }
 
-        memcpy(&treeHeight,buffer+PageFile::PAGE_SIZE-sizeof(int),sizeof(int));
+        rootPid=0;
+        treeHeight=level+1;
+
+        //a leaf root holds every entry. the sizes of the children of a
+        //nonleaf root add up to the count
+        if(level==0)
+        {
+            BTLeafNode root(pf.getPageSize());
+            rc=root.read(0,pf);
+            entryCount=root.getKeyCount();
+        }
+        else
+        {
+            BTNonLeafNode root(pf.getPageSize());
+            rc=root.read(0,pf);
+            entryCount=root.getSubtreeTotal();
+        }
+        if(rc)
+        {
+            pf.close();
+            return rc;
+        }
     }
 
     //if we got here then success
@@ -74,7 +108,9 @@ RC BTreeIndex::open(const string& indexname, char mode)
  */
 RC BTreeIndex::close()
 {
-    RC rc=pf.close();
+    RC rc;
+
+    rc=pf.close();
     
     return rc;
 }
@@ -86,6 +122,20 @@ RC BTreeIndex::close()
  * @return error code. 0 if no error
  */
 RC BTreeIndex::insert(int key, const RecordId& rid)
+{
+    RC rc=insertEntry(key,rid);
+    if(!rc)
+        entryCount++;
+    return rc;
+}
+
+/*
+ * Insert (key, RecordId) pair to the index without counting it.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::insertEntry(int key, const RecordId& rid)
 {
     RC rc;
     //if no root, make one
@@ -93,7 +143,7 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
     {
         //create a root
         //root is leaf node at first
-        BTLeafNode newTreeRoot;
+        BTLeafNode newTreeRoot(pf.getPageSize());
 
         //insert the key and rid into root
         newTreeRoot.insert(key,rid);
@@ -103,7 +153,6 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
 
         //root has height of 1
         treeHeight=1;
-        memcpy(newTreeRoot.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&treeHeight,sizeof(int));
 
         //write data to disk
         newTreeRoot.write(rootPid,pf);
@@ -117,9 +166,10 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
         //variables to pass data into on root overflow
         int pKey;
         PageId pPid;
+        int pSize;
 
         //attempt to insert recursively
-        rc=insertRecursively(key,rid,1,rootPid,pKey,pPid);
+        rc=insertRecursively(key,rid,1,rootPid,pKey,pPid,pSize);
         //failure
         if(rc && rc!=1000)
             return rc;
@@ -133,18 +183,18 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
         {
             if(treeHeight==1)//root is leaf
             {
-                BTLeafNode newLeaf;
+                BTLeafNode newLeaf(pf.getPageSize());
                 newLeaf.read(rootPid,pf);
                 PageId newLeafPid=pf.endPid();
                 newLeaf.setNextNodePtr(pPid);
                 newLeaf.write(newLeafPid,pf);
                 
-                BTNonLeafNode rootNode;
-                rootNode.initializeRoot(newLeafPid,pKey,pPid);
+                BTNonLeafNode rootNode(pf.getPageSize());
+                rootNode.initializeRoot(newLeafPid,pKey,pPid,newLeaf.getKeyCount(),pSize);
+                rootNode.setLevel(treeHeight);
 
                 //increment treeHeight
                 treeHeight+=1;
-                memcpy(rootNode.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&treeHeight,sizeof(int));
 
                 //write data to disk
                 rootNode.write(rootPid,pf);
@@ -152,17 +202,17 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
             }
             else//root is nonleaf 
             {
-                BTNonLeafNode newNode;
+                BTNonLeafNode newNode(pf.getPageSize());
                 newNode.read(rootPid,pf);
                 PageId newNodePid=pf.endPid();
                 newNode.write(newNodePid,pf);
                 
-                BTNonLeafNode rootNode;
-                rootNode.initializeRoot(newNodePid,pKey,pPid);
+                BTNonLeafNode rootNode(pf.getPageSize());
+                rootNode.initializeRoot(newNodePid,pKey,pPid,newNode.getSubtreeTotal(),pSize);
+                rootNode.setLevel(treeHeight);
 
                 //increment treeHeight
                 treeHeight+=1;
-                memcpy(rootNode.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&treeHeight,sizeof(int));
                 //write data to disk
                 rootNode.write(rootPid,pf);
             }
@@ -177,6 +227,272 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
     return -1;
 }
 
+/*
+ * Set how full bulkLoad() packs the nodes.
+ * @param percent[IN] the fill factor in percent, 1 to 100
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::setFillFactor(int percent)
+{
+    if(percent<1 || percent>100)
+        return RC_INVALID_ATTRIBUTE;
+    fillFactor=percent;
+    return 0;
+}
+
+/*
+ * Build the index bottom-up from sorted (key, RecordId) pairs.
+ * @param entries[IN] the pairs to load. finish() must have been called.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::bulkLoad(ExternalSort& entries)
+{
+    RC rc;
+    IndexEntry entry;
+
+    //the tree already has entries, so it cannot be rebuilt from scratch.
+    //insert the pairs in key order instead
+    if(treeHeight!=0)
+    {
+        while((rc=entries.next(entry))==0)
+        {
+            rc=insert(entry.key,entry.rid);
+            if(rc)
+                return rc;
+        }
+        return rc==RC_END_OF_TREE ? 0 : rc;
+    }
+
+    long count=entries.size();
+    if(count==0)
+        return 0;
+
+    int pageSize=pf.getPageSize();
+    BTLeafNode leaf(pageSize);
+    BTNonLeafNode nonLeaf(pageSize);
+
+    //# of pairs per leaf
+    int maxKeys=leaf.getMaxKeys();
+    long leafCap=(long)maxKeys*fillFactor/100;
+    if(leafCap<1)
+        leafCap=1;
+
+    long numLeaves=(count+leafCap-1)/leafCap;
+
+    //the root must be page 0, so it is written last and the other
+    //nodes start at page 1. the pairs are spread evenly over the leaves
+    vector<int> keys;
+    vector<PageId> pids;
+    vector<int> sizes;
+    vector<int> leafKeys(count/numLeaves+1);
+    vector<RecordId> leafRids(count/numLeaves+1);
+    for(long i=0;i<numLeaves;i++)
+    {
+        int size=count/numLeaves+(i<count%numLeaves ? 1 : 0);
+        for(int j=0;j<size;j++)
+        {
+            if((rc=entries.next(entry))<0)
+                return rc;
+            leafKeys[j]=entry.key;
+            leafRids[j]=entry.rid;
+        }
+
+        PageId pid=(numLeaves==1) ? 0 : i+1;
+        PageId next=(i+1<numLeaves) ? pid+1 : 0;
+        if((rc=leaf.fill(&leafKeys[0],&leafRids[0],size,next))<0)
+            return rc;
+        if((rc=leaf.write(pid,pf))<0)
+            return rc;
+
+        //the first key of each node separates it from its left sibling
+        keys.push_back(leafKeys[0]);
+        pids.push_back(pid);
+        sizes.push_back(size);
+    }
+
+    //build the nonleaf levels until a single root is left
+    int height=1;
+    long childCap=(long)(nonLeaf.getMaxKeys()+1)*fillFactor/100;
+    if(childCap<2)
+        childCap=2;
+    while(pids.size()>1)
+    {
+        long n=pids.size();
+        long numNodes=(n+childCap-1)/childCap;
+        //every node needs at least two children
+        if(numNodes>n/2)
+            numNodes=n/2;
+
+        vector<int> upKeys;
+        vector<PageId> upPids;
+        vector<int> upSizes;
+        long start=0;
+        for(long i=0;i<numNodes;i++)
+        {
+            long size=n/numNodes+(i<n%numNodes ? 1 : 0);
+
+            //children start..start+size-1 and the keys between them
+            if((rc=nonLeaf.fill(&keys[start+1],&pids[start],size-1,&sizes[start]))<0)
+                return rc;
+            nonLeaf.setLevel(height);
+
+            //the root goes to page 0
+            PageId pid=(numNodes==1) ? 0 : pf.endPid();
+            if((rc=nonLeaf.write(pid,pf))<0)
+                return rc;
+
+            upKeys.push_back(keys[start]);
+            upPids.push_back(pid);
+            upSizes.push_back(nonLeaf.getSubtreeTotal());
+            start+=size;
+        }
+
+        keys.swap(upKeys);
+        pids.swap(upPids);
+        sizes.swap(upSizes);
+        height++;
+    }
+
+    rootPid=0;
+    treeHeight=height;
+    entryCount=count;
+    return 0;
+}
+
+/*
+ * Return the number of entries in the index.
+ * @param count[OUT] the number of entries
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::getEntryCount(int& count)
+{
+    count=entryCount;
+    return 0;
+}
+
+/*
+ * Count the entries with keys between low and high.
+ * @param low[IN] the smallest key to count
+ * @param high[IN] the largest key to count
+ * @param count[OUT] the # of entries with low <= key <= high
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::countRange(int low, int high, int& count)
+{
+    RC rc;
+    int lowRank=0;
+    int highRank;
+
+    count=0;
+    if(low>high || treeHeight==0)
+        return 0;
+
+    //the entries smaller than high+1 minus those smaller than low
+    if(high==INT_MAX)
+        rc=getEntryCount(highRank);
+    else
+        rc=rank(high+1,highRank);
+    if(rc)
+        return rc;
+    if(low!=INT_MIN && (rc=rank(low,lowRank)))
+        return rc;
+
+    count=highRank-lowRank;
+    return 0;
+}
+
+/*
+ * Find the # of entries with keys smaller than searchKey by adding up
+ * the sizes of the children left of the path down to searchKey.
+ * @param searchKey[IN] the key to rank
+ * @param rank[OUT] the # of smaller entries
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::rank(int searchKey, int& rank)
+{
+    RC rc;
+    PageId pid=rootPid;
+    int eid;
+    BTNonLeafNode nlNode(pf.getPageSize());
+    BTLeafNode lNode(pf.getPageSize());
+
+    rank=0;
+    for(int h=1;h<treeHeight;h++)
+    {
+        rc=nlNode.pin(pid,pf);
+        if(rc)
+            return rc;
+        rc=nlNode.locateChildPtr(searchKey,pid,eid);
+        if(rc)
+            return rc;
+
+        //every entry left of the child followed is smaller
+        for(int i=0;i<eid;i++)
+            rank+=nlNode.getSubtreeSize(i);
+    }
+
+    rc=lNode.pin(pid,pf);
+    if(rc)
+        return rc;
+    lNode.locate(searchKey,eid);
+    rank+=eid;
+    return 0;
+}
+
+/*
+ * Find the key of the entry at a position in key order.
+ * @param rank[IN] the position of the entry, 0 for the smallest key
+ * @param key[OUT] the key of the entry
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::keyAtRank(int rank, int& key)
+{
+    RC rc;
+    PageId pid=rootPid;
+    RecordId rid;
+    BTNonLeafNode nlNode(pf.getPageSize());
+    BTLeafNode lNode(pf.getPageSize());
+
+    if(rank<0||treeHeight<1)
+        return RC_NO_SUCH_RECORD;
+    for(int h=1;h<treeHeight;h++)
+    {
+        rc=nlNode.pin(pid,pf);
+        if(rc)
+            return rc;
+
+        //skip the children whose entries all come before rank
+        int i;
+        int n=nlNode.getKeyCount();
+        for(i=0;i<=n;i++)
+        {
+            int size=nlNode.getSubtreeSize(i);
+            if(rank<size)
+                break;
+            rank-=size;
+        }
+        if(i>n)
+            return RC_NO_SUCH_RECORD;
+        pid=nlNode.getChildPtr(i);
+    }
+
+    rc=lNode.pin(pid,pf);
+    if(rc)
+        return rc;
+    if(rank>=lNode.getKeyCount())
+        return RC_NO_SUCH_RECORD;
+    return lNode.readEntry(rank,key,rid);
+}
+
+/*
+ * Return the # of entries a full leaf node holds.
+ * @return the leaf capacity
+ */
+int BTreeIndex::getLeafCapacity() const
+{
+    BTLeafNode lNode(pf.getPageSize());
+    return lNode.getMaxKeys();
+}
 
 /*
  * Insert (key, RecordId) pair while handling overflows
@@ -191,20 +507,22 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
  * @param pid[IN] the pid of the current node
  * @param pKey[IN] on overflow, variable used to pass key to insert to parent
  * @param pPid[IN] on overflow, variable used to pass pid to insert to parent
+ * @param pSize[IN] on overflow, variable used to pass the # of entries
+ *                  under pPid to the parent
  * @return error code. 0 if no error
  */
-RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, int& pKey, PageId& pPid)
+RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, int& pKey, PageId& pPid, int& pSize)
 {
     RC rc;
-    BTLeafNode currLeaf;
+    BTLeafNode currLeaf(pf.getPageSize());
     int sibKey;
     PageId sibPid;
-    BTNonLeafNode nonLeaf;
+    BTNonLeafNode nonLeaf(pf.getPageSize());
     PageId nextPid;
     //the current node is leaf node
     if(currHeight==treeHeight)
     {
-        BTLeafNode sibNode;
+        BTLeafNode sibNode(pf.getPageSize());
         //obtain current leaf node data
         currLeaf.read(pid,pf);
 
@@ -213,17 +531,11 @@ RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, P
         if(!rc)
         {
             //success: write and return
-            if(treeHeight==1)
-                memcpy(currLeaf.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&treeHeight,sizeof(int));
             currLeaf.write(pid,pf);
             return rc;
         }
         //failure: overflow
         //insertAndSplit since overflow
-         if(treeHeight==1){
-            int tempnum=0; 
-            memcpy(currLeaf.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&tempnum,sizeof(int));
-            }
         rc=currLeaf.insertAndSplit(key,rid,sibNode,sibKey);
 
         //return on failure
@@ -250,6 +562,7 @@ RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, P
         //transfer over to p variables
         pKey=sibKey;
         pPid=sibPid;
+        pSize=sibNode.getKeyCount();
         
         //successful but need to tell caller to insert into parent
         return 1000;
@@ -257,38 +570,51 @@ RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, P
     }
     else//nonleaf node, continue traverasl
     {
-        BTNonLeafNode sibNode;
+        BTNonLeafNode sibNode(pf.getPageSize());
         //locate child so we can recursively call on it
         nonLeaf.read(pid,pf);
 
-        rc=nonLeaf.locateChildPtr(key,nextPid);
+        int childEid;
+        rc=nonLeaf.locateChildPtr(key,nextPid,childEid);
 
         //return on failure
         if(rc)
             return rc;
 
         //insert recursively into child
-        rc=insertRecursively(key,rid,currHeight+1,nextPid,pKey,pPid);
+        rc=insertRecursively(key,rid,currHeight+1,nextPid,pKey,pPid,pSize);
 
         //insertion failed
         if(rc && rc!=1000)
             return rc;
 
+        //the child holds one more entry than before, split or not
+        int childSize=nonLeaf.getSubtreeSize(childEid)+1;
+
+        //no split: count the new entry
+        if(!rc)
+        {
+            nonLeaf.setSubtreeSize(childEid,childSize);
+            return nonLeaf.write(pid,pf);
+        }
+
         //insertion successful but split occured, handle any overflow insertions
         if(rc==1000)
         {
+            //the entries of the child are now shared with its new sibling
+            int leftSize=childSize-pSize;
+
             //attempt insertion
-            rc=nonLeaf.insert(pKey,pPid);
+            //the new child goes right behind the one that split
+            rc=nonLeaf.insert(pKey,pPid,childEid,leftSize,pSize);
             if(!rc)//success
             {
-                if(pid==0)
-                    memcpy(nonLeaf.getBuffer()+PageFile::PAGE_SIZE-sizeof(int),&treeHeight,sizeof(int));
                 nonLeaf.write(pid,pf);
                 return 0;
             }
             else//insertion failure: overflow
             {
-                nonLeaf.insertAndSplit(pKey,pPid,sibNode,sibKey);
+                nonLeaf.insertAndSplit(pKey,pPid,sibNode,sibKey,childEid,leftSize,pSize);
                 sibPid=pf.endPid();
                 //write data
                 sibNode.write(sibPid,pf);
@@ -297,6 +623,7 @@ RC BTreeIndex::insertRecursively(int key, const RecordId& rid, int currHeight, P
                 //transfer data to p variables
                 pKey=sibKey;
                 pPid=sibPid;
+                pSize=sibNode.getSubtreeTotal();
 
                 return 1000;
             }
@@ -333,7 +660,7 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
     PageId pid=rootPid;
     int tempEid=-1;
     int searchPid;
-    BTLeafNode lNode;
+    BTLeafNode lNode(pf.getPageSize());
 
     //root is leaf
 
@@ -343,7 +670,7 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
         {
             return 0;
         }
-        rc=lNode.read(pid,pf);
+        rc=lNode.pin(pid,pf);
         if(rc)
             return rc;
 
@@ -352,7 +679,7 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
         //regardless of success or failure, locate will set tempEid to the correct
         //value
         cursor.pid=pid;
-        cursor.eid=tempEid/(sizeof(RecordId)+sizeof(int));
+        cursor.eid=tempEid;
         return rc;
 
     }
@@ -360,7 +687,7 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
     {
         rc=locateRecursively(searchKey,pid,tempEid,1);
         cursor.pid=pid;
-        cursor.eid=tempEid/(sizeof(RecordId)+sizeof(int));
+        cursor.eid=tempEid;
         return rc;
 
     }
@@ -375,10 +702,10 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
 RC BTreeIndex::locateRecursively(int searchKey, PageId& pid, PageId& eid, int currHeight)
 {
     RC rc;
-    BTNonLeafNode nlNode;
-    BTLeafNode lNode;
+    BTNonLeafNode nlNode(pf.getPageSize());
+    BTLeafNode lNode(pf.getPageSize());
     //search node
-    rc=nlNode.read(pid,pf);
+    rc=nlNode.pin(pid,pf);
     if(rc)
         return rc;
 
@@ -389,7 +716,7 @@ RC BTreeIndex::locateRecursively(int searchKey, PageId& pid, PageId& eid, int cu
 
     if(currHeight+1==treeHeight)
     {
-        rc=lNode.read(pid,pf);
+        rc=lNode.pin(pid,pf);
 
         if(rc)
             return rc;
@@ -407,6 +734,142 @@ RC BTreeIndex::locateRecursively(int searchKey, PageId& pid, PageId& eid, int cu
     }
 }
 
+/*
+ * orders positions in a list of keys by the key at the position.
+ */
+struct ProbeOrder {
+    const int* keys;
+    ProbeOrder(const int* k) : keys(k) { }
+    bool operator()(size_t a, size_t b) const { return keys[a]<keys[b]; }
+};
+
+/*
+ * Look up many keys at once.
+ * @param keys[IN] the keys to look up
+ * @param n[IN] the number of keys
+ * @param outKeys[OUT] the keys of the entries found, in key order
+ * @param outRids[OUT] the RecordIds of the entries found
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::lookupBatch(const int* keys, size_t n, vector<int>& outKeys, vector<RecordId>& outRids)
+{
+    outKeys.clear();
+    outRids.clear();
+    if(treeHeight==0||n==0)
+        return 0;
+
+    //probe in key order so that keys sharing a node are next to each other
+    vector<size_t> order(n);
+    for(size_t i=0;i<n;i++)
+        order[i]=i;
+    sort(order.begin(),order.end(),ProbeOrder(keys));
+
+    return lookupRecursively(rootPid,1,LLONG_MAX,keys,&order[0],n,outKeys,outRids);
+}
+
+/*
+ * Resolve a run of sorted probes under the node pid.
+ * The node is pinned once, and the probes are split into runs going to
+ * the same child, each run visiting its child once.
+ * @param pid[IN] the node to search
+ * @param currHeight[IN] the height of the node, root=1
+ * @param bound[IN] the separator right of the node, LLONG_MAX if none
+ * @param keys[IN] the keys to look up
+ * @param order[IN] the positions in keys of the probes, sorted by key
+ * @param n[IN] the number of probes
+ * @param outKeys[OUT] the keys of the entries found
+ * @param outRids[OUT] the RecordIds of the entries found
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::lookupRecursively(PageId pid, int currHeight, long long bound, const int* keys,
+                                 const size_t* order, size_t n, vector<int>& outKeys,
+                                 vector<RecordId>& outRids)
+{
+    RC rc;
+
+    if(currHeight==treeHeight)
+    {
+        BTLeafNode lNode(pf.getPageSize());
+        BTLeafNode nextNode(pf.getPageSize());
+        int eid;
+        int key;
+        RecordId rid;
+
+        //probes land on scattered leaves, which read-ahead would mistake
+        //for a scan whenever two of them are neighbours
+        rc=lNode.pin(pid,pf,false);
+        if(rc)
+            return rc;
+        for(size_t i=0;i<n;i++)
+        {
+            int searchKey=keys[order[i]];
+            if(i>0&&keys[order[i-1]]==searchKey)
+                continue;
+
+            //read the entries with the key. a run of duplicates may go
+            //on into the next leaves, so follow the next pointers until
+            //a larger key shows up. the next leaf starts at bound or
+            //later, so it is not read for a smaller key
+            BTLeafNode* node=&lNode;
+            lNode.locate(searchKey,eid);
+            while(true)
+            {
+                if(node->readEntry(eid,key,rid)==0)
+                {
+                    if(key!=searchKey)
+                        break;
+                    outKeys.push_back(key);
+                    outRids.push_back(rid);
+                    eid++;
+                    continue;
+                }
+                if(searchKey<bound||node->getNextNodePtr()==0)
+                    break;
+                if((rc=nextNode.pin(node->getNextNodePtr(),pf,false)))
+                    return rc;
+                node=&nextNode;
+                eid=0;
+            }
+        }
+        return 0;
+    }
+
+    BTNonLeafNode nlNode(pf.getPageSize());
+    rc=nlNode.pin(pid,pf,false);
+    if(rc)
+        return rc;
+
+    size_t i=0;
+    while(i<n)
+    {
+        PageId child;
+        int eid;
+        if((rc=nlNode.locateChildPtr(keys[order[i]],child,eid)))
+            return rc;
+
+        //the probes up to the next separator follow the same child
+        size_t j=i+1;
+        while(j<n)
+        {
+            PageId nextChild;
+            int nextEid;
+            if((rc=nlNode.locateChildPtr(keys[order[j]],nextChild,nextEid)))
+                return rc;
+            if(nextEid!=eid)
+                break;
+            j++;
+        }
+
+        //the key right of the child bounds it. the last child is
+        //bounded like the node
+        long long childBound=(eid<nlNode.getKeyCount()) ? nlNode.getKey(eid) : bound;
+        if((rc=lookupRecursively(child,currHeight+1,childBound,keys,order+i,j-i,outKeys,outRids)))
+            return rc;
+        i=j;
+    }
+    return 0;
+}
+
 /*
  * Read the (key, rid) pair at the location specified by the index cursor,
  * and move foward the cursor to the next entry.
@@ -418,23 +881,37 @@ RC BTreeIndex::locateRecursively(int searchKey, PageId& pid, PageId& eid, int cu
 RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
 {
     RC rc;
-    BTLeafNode lNode;
+    BTLeafNode lNode(pf.getPageSize());
     PageId pid=cursor.pid;
     int eid=cursor.eid;
 
-    //read into node
-    rc=lNode.read(pid,pf);
+    //pin the leaf, no need to copy it
+    rc=lNode.pin(pid,pf);
 
     if(rc)
         return rc;
 
+    //locate leaves the cursor behind the last entry of a leaf when
+    //searchKey falls between two leaves. continue in the next leaf
+    if(eid>=lNode.getKeyCount() && lNode.getNextNodePtr()!=0)
+    {
+        pid=lNode.getNextNodePtr();
+        eid=0;
+        rc=lNode.pin(pid,pf);
+        if(rc)
+            return rc;
+    }
+
     //read node data into key and rid
-    int temp_eid=eid*(sizeof(RecordId)+sizeof(int));
-    rc=lNode.readEntry(temp_eid,key,rid);
+    rc=lNode.readEntry(eid,key,rid);
 
     if(rc)
         return rc;
 
+    //entering a new leaf, let the next one load while this one is scanned
+    if(eid==0 && lNode.getNextNodePtr()!=0)
+        pf.prefetch(lNode.getNextNodePtr(),lNode.getNextNodePtr()+1);
+
     if((eid+1)>=(lNode.getKeyCount()))
     {
         //next index should be in the next node
@@ -458,13 +935,136 @@ RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
     return 0;
 }
 
+/*
+ * Start iterating over the index entries from the location specified
+ * by the index cursor.
+ * @param cursor[IN] the cursor pointing to the first entry to read
+ * @param it[OUT] the iterator to start
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::scan(const IndexCursor& cursor, IndexIterator& it)
+{
+    it.pf=&pf;
+    it.done=true;
+
+    //an empty tree or a cursor past the end
+    if(treeHeight==0 || cursor.eid<0)
+        return 0;
+
+    RC rc=it.enter(cursor.pid);
+    if(rc)
+        return rc;
+    it.eid=cursor.eid;
+    return 0;
+}
+
+/*
+ * Move an iterator forward to the first entry with a key not smaller
+ * than searchKey.
+ * @param searchKey[IN] the key to move to
+ * @param it[IN/OUT] the iterator
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::seek(int searchKey, IndexIterator& it)
+{
+    RC rc;
+    IndexCursor cursor;
+
+    if(it.done)
+        return 0;
+
+    //the key is in the rest of the current leaf
+    int n=it.leaf.getKeyCount();
+    int last;
+    RecordId rid;
+    if(n>0 && it.leaf.readEntry(n-1,last,rid)==0 && last>=searchKey)
+    {
+        int eid;
+        it.leaf.locate(searchKey,eid);
+        if(eid>it.eid)
+            it.eid=eid;
+        return 0;
+    }
+
+    //otherwise search from the root
+    cursor.pid=-1;
+    cursor.eid=-1;
+    rc=locate(searchKey,cursor);
+    if(rc && rc!=RC_NO_SUCH_RECORD)
+        return rc;
+    return scan(cursor,it);
+}
+
+IndexIterator::IndexIterator()
+{
+    pf=NULL;
+    eid=0;
+    done=true;
+}
+
+/*
+ * Pin the leaf pid and start at its first entry.
+ * @param pid[IN] the leaf to move to
+ * @return error code. 0 if no error
+ */
+RC IndexIterator::enter(PageId pid)
+{
+    RC rc=leaf.pin(pid,*pf);
+    if(rc)
+    {
+        done=true;
+        return rc;
+    }
+    eid=0;
+    done=false;
+
+    //let the next leaf load while this one is scanned
+    if(leaf.getNextNodePtr()!=0)
+        pf->prefetch(leaf.getNextNodePtr(),leaf.getNextNodePtr()+1);
+    return 0;
+}
+
+/*
+ * Read the next entries in key order.
+ * @param keys[OUT] the keys of the entries
+ * @param rids[OUT] the RecordIds of the entries
+ * @param max[IN] the most entries to read
+ * @return the number of entries read, 0 at the end of the index,
+ *         or an error code
+ */
+int IndexIterator::next(int* keys, RecordId* rids, int max)
+{
+    int n=0;
+    while(n<max && !done)
+    {
+        //copy as much of the current leaf as fits
+        int got=leaf.readEntries(eid,keys+n,rids+n,max-n);
+        eid+=got;
+        n+=got;
+
+        //the leaf is used up, move on to the next one
+        if(eid>=leaf.getKeyCount())
+        {
+            PageId next=leaf.getNextNodePtr();
+            if(next==0)
+            {
+                done=true;
+                break;
+            }
+            RC rc=enter(next);
+            if(rc)
+                return n>0 ? n : rc;
+        }
+    }
+    return n;
+}
 
 void BTreeIndex::print()
 {
 
     if(treeHeight==1)
     {
-        BTLeafNode root;
+        BTLeafNode root(pf.getPageSize());
         root.read(rootPid,pf);
         root.print();
     }
@@ -476,12 +1076,11 @@ void BTreeIndex::print()
 
 void BTreeIndex::printRecNL(PageId pid,int heightLevel)
 {
-        BTNonLeafNode nonLeaf;
+        BTNonLeafNode nonLeaf(pf.getPageSize());
         nonLeaf.read(pid,pf);
 
         nonLeaf.print();
-        PageId first;
-        memcpy(&first,nonLeaf.getBuffer()+sizeof(int),sizeof(PageId));
+        PageId first=nonLeaf.getChildPtr(0);
 
 
 
@@ -497,7 +1096,7 @@ void BTreeIndex::printRecNL(PageId pid,int heightLevel)
                 //recursive call on all children
                 printRecNL(first, heightLevel+1);
 
-                memcpy(&first,nonLeaf.getBuffer()+sizeof(int)+((a+1)*(sizeof(PageId)+sizeof(int))),sizeof(PageId));
+                first=nonLeaf.getChildPtr(a+1);
             }
         }
 
@@ -505,11 +1104,10 @@ void BTreeIndex::printRecNL(PageId pid,int heightLevel)
 
 void BTreeIndex::printLeaf(PageId pid)
 {
-    BTLeafNode firstLeaf;
+    BTLeafNode firstLeaf(pf.getPageSize());
     firstLeaf.read(pid,pf);
     firstLeaf.print();
-    PageId tempPid;
-    memcpy(&tempPid,firstLeaf.getBuffer()+(firstLeaf.getKeyCount()*(sizeof(RecordId)+sizeof(int))),sizeof(PageId));
+    PageId tempPid=firstLeaf.getNextNodePtr();
 
     if(pid!=0 && tempPid!=0 && tempPid<10000)
         printLeaf(tempPid);
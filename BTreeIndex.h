@@ -10,9 +10,12 @@
 #ifndef BTREEINDEX_H
 #define BTREEINDEX_H
 
+#include <vector>
 #include "Bruinbase.h"
 #include "PageFile.h"
 #include "RecordFile.h"
+#include "ExternalSort.h"
+#include "BTreeNode.h"
              
 /**
  * The data structure to point to a particular entry at a b+tree leaf node.
@@ -27,6 +30,42 @@ typedef struct {
   int     eid;  
 } IndexCursor;
 
+/**
+ * Iterates over the index entries in key order. The iterator keeps the
+ * current leaf node pinned and hands out its entries in batches, moving
+ * to the next leaf only when the current one is used up.
+ * An iterator is started with BTreeIndex::scan() and must not outlive
+ * the index.
+ */
+class IndexIterator {
+ public:
+  IndexIterator();
+
+  /**
+   * Read the next entries in key order.
+   * @param keys[OUT] the keys of the entries
+   * @param rids[OUT] the RecordIds of the entries
+   * @param max[IN] the most entries to read
+   * @return the number of entries read, 0 at the end of the index,
+   *         or an error code
+   */
+  int next(int* keys, RecordId* rids, int max);
+
+ private:
+  friend class BTreeIndex;
+
+  // an iterator holds a pin, so it cannot be copied
+  IndexIterator(const IndexIterator&);
+  IndexIterator& operator=(const IndexIterator&);
+
+  RC enter(PageId pid);
+
+  const PageFile* pf;  /// the PageFile of the index
+  BTLeafNode leaf;     /// the current leaf node, pinned
+  int        eid;      /// the next entry in the leaf
+  bool       done;     /// true after the last entry
+};
+
 /**
  * Implements a B-Tree index for bruinbase.
  * 
@@ -39,8 +78,9 @@ class BTreeIndex {
    * Open the index file in read or write mode.
    * Under 'w' mode, the index file should be created if it does not exist.
    * @param indexname[IN] the name of the index file
-   * @param mode[IN] 'r' for read, 'w' for write
-   * @return error code. 0 if no error
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
+   * @return error code. 0 if no error. RC_INVALID_FILE_FORMAT if the root
+   *         has no node header, as in indexes written by the first version
    */
   RC open(const std::string& indexname, char mode);
 
@@ -58,6 +98,67 @@ class BTreeIndex {
    */
   RC insert(int key, const RecordId& rid);
 
+  /**
+   * Build the index bottom-up from sorted (key, RecordId) pairs.
+   * The leaves are packed left to right up to the fill factor and
+   * written in one sequential pass, and each nonleaf level is built
+   * on top of the one below. If the index already has entries,
+   * the pairs are inserted one by one instead.
+   * @param entries[IN] the pairs to load. finish() must have been called.
+   * @return error code. 0 if no error
+   */
+  RC bulkLoad(ExternalSort& entries);
+
+  /**
+   * Set how full bulkLoad() packs the nodes.
+   * @param percent[IN] the fill factor in percent, 1 to 100
+   * @return error code. 0 if no error
+   */
+  static RC setFillFactor(int percent);
+
+  static const int DEFAULT_FILL_FACTOR = 100; // bulk load fill factor in percent
+
+  /**
+   * Return the number of entries in the index. The count is taken from
+   * the subtree sizes in the root when the index is opened, so no leaf
+   * is read.
+   * @param count[OUT] the number of entries
+   * @return error code. 0 if no error
+   */
+  RC getEntryCount(int& count);
+
+  /**
+   * Count the entries with keys between low and high. The nonleaf nodes
+   * keep the # of entries under each child, so only the paths from the
+   * root to low and to high are read.
+   * @param low[IN] the smallest key to count
+   * @param high[IN] the largest key to count
+   * @param count[OUT] the # of entries with low <= key <= high
+   * @return error code. 0 if no error
+   */
+  RC countRange(int low, int high, int& count);
+
+  /**
+   * Find the key of the entry at a position in key order. The path is
+   * chosen by the # of entries under each child, so only one node per
+   * level is read.
+   * @param rank[IN] the position of the entry, 0 for the smallest key
+   * @param key[OUT] the key of the entry
+   * @return error code. 0 if no error. RC_NO_SUCH_RECORD if rank is out
+   *         of range or a node on the path does not know its sizes
+   */
+  RC keyAtRank(int rank, int& key);
+
+  /**
+   * @return the height of the tree, 0 if it is empty
+   */
+  int getTreeHeight() const { return treeHeight; }
+
+  /**
+   * @return the # of entries a full leaf node holds
+   */
+  int getLeafCapacity() const;
+
 
 /*
  * Insert (key, RecordId) pair while handling overflows
@@ -72,9 +173,11 @@ class BTreeIndex {
  * @param pid[IN] the pid of the current node
  * @param pKey[IN] on overflow, variable used to pass key to insert to parent
  * @param pPid[IN] on overflow, variable used to pass pid to insert to parent
+ * @param pSize[IN] on overflow, variable used to pass the # of entries
+ *                  under pPid to the parent
  * @return error code. 0 if no error
  */
-RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, int& pKey, PageId& pPid);
+RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, int& pKey, PageId& pPid, int& pSize);
 
   /**
    * Run the standard B+Tree key search algorithm and identify the
@@ -96,6 +199,21 @@ RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, i
    */
   RC locate(int searchKey, IndexCursor& cursor);
 
+  /**
+   * Look up many keys at once. The keys are probed in sorted order and
+   * split among the children of each node on the way down, so every
+   * node on the paths to the keys is read once for the whole batch
+   * instead of once per key.
+   * @param keys[IN] the keys to look up, in any order
+   * @param n[IN] the number of keys
+   * @param outKeys[OUT] the keys of all entries with one of the keys,
+   *                     in key order. a key probed twice is read once
+   * @param outRids[OUT] the RecordIds of the entries in outKeys
+   * @return error code. 0 if no error
+   */
+  RC lookupBatch(const int* keys, size_t n, std::vector<int>& outKeys,
+                 std::vector<RecordId>& outRids);
+
   /**
    * Read the (key, rid) pair at the location specified by the index cursor,
    * and move foward the cursor to the next entry.
@@ -105,6 +223,27 @@ RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, i
    * @return error code. 0 if no error
    */
   RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Start iterating over the index entries from the location specified
+   * by the index cursor. Use this instead of readForward() to read many
+   * entries in a row.
+   * @param cursor[IN] the cursor pointing to the first entry to read
+   * @param it[OUT] the iterator to start
+   * @return error code. 0 if no error
+   */
+  RC scan(const IndexCursor& cursor, IndexIterator& it);
+
+  /**
+   * Move an iterator forward to the first entry with a key not smaller
+   * than searchKey. The rest of the leaf the iterator is on is searched
+   * first, so a key near the last one read takes no descent from the
+   * root. The iterator never moves back.
+   * @param searchKey[IN] the key to move to
+   * @param it[IN/OUT] the iterator, started with scan()
+   * @return error code. 0 if no error
+   */
+  RC seek(int searchKey, IndexIterator& it);
   
   RC locateRecursively(int searchKey, PageId& pid, PageId& eid, int currHeight);
   void print();
@@ -112,6 +251,41 @@ RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, i
   void printLeaf(PageId pid);
 
  private:
+  /**
+   * Insert (key, RecordId) pair to the index without counting it
+   * in the entry count.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. 0 if no error
+   */
+  RC insertEntry(int key, const RecordId& rid);
+
+  /**
+   * Find the # of entries with keys smaller than searchKey by adding up
+   * the sizes of the children left of the path down to searchKey.
+   * @param searchKey[IN] the key to rank
+   * @param rank[OUT] the # of entries with smaller keys
+   * @return error code. 0 if no error
+   */
+  RC rank(int searchKey, int& rank);
+
+  /**
+   * Look up the probes of lookupBatch() that lead to the node pid.
+   * @param pid[IN] the node to search
+   * @param currHeight[IN] the height of the node, root=1
+   * @param bound[IN] the separator right of the node. the keys behind
+   *                  the node are not smaller. LLONG_MAX if there is none
+   * @param keys[IN] the keys to look up
+   * @param order[IN] the positions in keys of the probes, sorted by key
+   * @param n[IN] the number of probes
+   * @param outKeys[OUT] the entries found are appended here
+   * @param outRids[OUT] the RecordIds of the entries found
+   * @return error code. 0 if no error
+   */
+  RC lookupRecursively(PageId pid, int currHeight, long long bound, const int* keys,
+                       const size_t* order, size_t n, std::vector<int>& outKeys,
+                       std::vector<RecordId>& outRids);
+
   PageFile pf;         /// the PageFile used to store the actual b+tree in disk
 
   PageId   rootPid;    /// the PageId of the root node
@@ -120,6 +294,9 @@ RC insertRecursively(int key, const RecordId& rid, int currHeight, PageId pid, i
   /// this class is destructed. Make sure to store the values of the two 
   /// variables in disk, so that they can be reconstructed when the index
   /// is opened again later.
+
+  int      entryCount;   /// # of entries in the index
+  static int fillFactor; /// how full bulkLoad() packs the nodes, in percent
 };
 
 #endif /* BTREEINDEX_H */
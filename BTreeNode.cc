@@ -1,22 +1,163 @@
 #include "BTreeNode.h"
-#include <math.h>
+#include "KeySearch.h"
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <vector>
 using namespace std;
 
 #define L_PAIR_SIZE (sizeof(RecordId)+sizeof(int))
 #define NL_PAIR_SIZE (sizeof(PageId)+sizeof(int))
 
+//every node starts with a header:
+//count(int),level(short),flags(short),next(PageId)
+//next links a leaf to its right sibling. nonleaf nodes do not use it
+#define COUNT_OFFSET 0
+#define LEVEL_OFFSET 4
+#define FLAGS_OFFSET 6
+#define NEXT_OFFSET 8
+#define HEADER_SIZE 12
+
+//flags of a node. the magic bits tell a node apart from a page of an
+//index written before nodes had a header, or with an earlier layout of
+//the entries (0xB000: keys next to their rids, 0xC000: nonleaf nodes
+//without subtree sizes). such indexes are not read; they have to be
+//rebuilt by loading the table again
+#define NODE_MAGIC 0xD000
+#define NODE_MAGIC_MASK 0xF000
+#define NODE_LEAF 0x0001
+
+//the entries follow the header, with all keys next to each other:
+//  leaf: header,key,key,...,rid,rid,...
+//  nonleaf: header,key,key,...,pid,pid,...,size,size,...
+//each array has room for getMaxKeys() keys (and one more pid and size).
+//size i is the # of entries under child i.
+
+static int readInt(const char* p)
+{
+    int v;
+    memcpy(&v,p,sizeof(int));
+    return v;
+}
+
+static void writeInt(char* p, int v)
+{
+    memcpy(p,&v,sizeof(int));
+}
+
+//search the sorted keys of a node: the index of the first key larger
+//than key, or n if there is none. binary search until few keys are left;
+//the loop body has no data dependent branch, only conditional moves.
+//the keys left are counted several at a time
+static int upperBoundOf(const char* keys, int n, int key)
+{
+    int lo=0;
+    while(n>KeySearch::WINDOW)
+    {
+        int half=n/2;
+        bool right=readInt(keys+(lo+half)*sizeof(int))<=key;
+        lo=right ? lo+half+1 : lo;
+        n=right ? n-half-1 : half;
+    }
+    return lo+KeySearch::countNotGreater((const int*)keys+lo,n,key);
+}
+
+//the index of the first key not smaller than key, or n if there is none
+static int lowerBoundOf(const char* keys, int n, int key)
+{
+    int lo=0;
+    while(n>KeySearch::WINDOW)
+    {
+        int half=n/2;
+        bool right=readInt(keys+(lo+half)*sizeof(int))<key;
+        lo=right ? lo+half+1 : lo;
+        n=right ? n-half-1 : half;
+    }
+    return lo+KeySearch::countLess((const int*)keys+lo,n,key);
+}
+
+//set up an empty node header
+static void initHeader(char* buf, int level, bool leaf)
+{
+    unsigned short flags=NODE_MAGIC|(leaf ? NODE_LEAF : 0);
+    short lvl=level;
+    writeInt(buf+COUNT_OFFSET,0);
+    memcpy(buf+LEVEL_OFFSET,&lvl,sizeof(short));
+    memcpy(buf+FLAGS_OFFSET,&flags,sizeof(short));
+    writeInt(buf+NEXT_OFFSET,0);
+}
+
+/*
+ * Read the level of the node stored in a page. Leaves are at level 0.
+ * @param page[IN] the content of the page
+ * @param level[OUT] the level of the node
+ * @return 0 if successful. RC_INVALID_FILE_FORMAT if the page does not
+ *         hold a node.
+ */
+RC readNodeLevel(const char* page, int& level)
+{
+    unsigned short flags;
+    short lvl;
+    memcpy(&flags,page+FLAGS_OFFSET,sizeof(short));
+    memcpy(&lvl,page+LEVEL_OFFSET,sizeof(short));
+
+    if((flags&NODE_MAGIC_MASK)!=NODE_MAGIC)
+        return RC_INVALID_FILE_FORMAT;
+    if(((flags&NODE_LEAF)!=0)!=(lvl==0) || lvl<0)
+        return RC_INVALID_FILE_FORMAT;
+
+    level=lvl;
+    return 0;
+}
+
 /*
  * Initializes variables
  */
- BTLeafNode::BTLeafNode()
+ BTLeafNode::BTLeafNode(int pageSize)
  {
-    memset(buffer, '\0', PageFile::PAGE_SIZE);
+    this->pageSize=pageSize;
+    page=new char[pageSize];
+    buffer=page;
+    memset(buffer, '\0', pageSize);
+    initHeader(buffer,0,true);
  }
 
+ BTLeafNode::~BTLeafNode()
+ {
+    pinned.unpin();
+    delete [] page;
+ }
+
+/*
+ * Switch the node to pages of the given size, dropping its content
+ * if the size changes.
+ * @param size[IN] the page size
+ */
+void BTLeafNode::setPageSize(int size)
+{
+    if(size==pageSize)
+        return;
+    delete [] page;
+    pageSize=size;
+    page=new char[pageSize];
+    memset(page, '\0', pageSize);
+    initHeader(page,0,true);
+}
+
+/*
+ * Locate the key and the rid of entry i in the node.
+ */
+char* BTLeafNode::keyPtr(int i)
+{
+    return buffer+HEADER_SIZE+i*sizeof(int);
+}
+
+char* BTLeafNode::ridPtr(int i)
+{
+    return buffer+HEADER_SIZE+getMaxKeys()*sizeof(int)+i*sizeof(RecordId);
+}
+
 
 /*
  * Read the content of the node from the page pid in the PageFile pf.
@@ -25,11 +166,32 @@ using namespace std;
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::read(PageId pid, const PageFile& pf)
-{ 
+{
+    //drop any pinned page and go back to the private buffer
+    pinned.unpin();
+    setPageSize(pf.getPageSize());
+    buffer=page;
+
     //read disk page with PageId pid into buffer and return
     return pf.read(pid, buffer);
 }
-    
+
+/*
+ * Use the page pid in the PageFile pf as the content of the node
+ * without copying it.
+ * @param pid[IN] the PageId to pin
+ * @param pf[IN] PageFile to pin the page from
+ * @param sequential[IN] false if the node is not read in page order
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::pin(PageId pid, const PageFile& pf, bool sequential)
+{
+    RC rc=pf.pin(pid, pinned, sequential);
+    setPageSize(pf.getPageSize());
+    buffer=rc ? page : pinned.data();
+    return rc;
+}
+
 /*
  * Write the content of the node to the page pid in the PageFile pf.
  * @param pid[IN] the PageId to write to
@@ -47,49 +209,19 @@ RC BTLeafNode::write(PageId pid, PageFile& pf)
  * @return the number of keys in the node
  */
 int BTLeafNode::getKeyCount()
-{   
-    int keyCounter=0;
-    char* tmp=buffer;
- 
-    int curr;
-    int i=4;//int i=0
-    //1008 because buffer is 1024, pairsize should be 12 so 1008+12 means
-    //1020 + the PageId which is 4 bytes.
-    while(i<1024)
-    {
-        memcpy(&curr,tmp,sizeof(int));
-        if(curr==0)
-            break;
-        //increment everything
-        keyCounter++;
-        tmp+=L_PAIR_SIZE;
-        i+=L_PAIR_SIZE;
-    }
-
-    if(keyCounter>1)
-    {
-        memcpy(&curr,tmp-sizeof(int),sizeof(int));
-        if(curr==0)
-        {
-            memcpy(&curr,tmp-2*sizeof(int),sizeof(int));
-            if(curr==0)
-            {
-                keyCounter--;
-            }
-        }
-    }
-
-    return keyCounter;
+{
+    //the count is kept in the node header
+    return readInt(buffer+COUNT_OFFSET);
 }
 
 /*
  * Returns the maximum number of keys that can be stored in the node
- * @return the max keys that can be stored in the node 
+ * @return the max keys that can be stored in the node
  */
 int BTLeafNode::getMaxKeys()
 {
-    //maxPairs should be 85
-    int maxPairs=floor((PageFile::PAGE_SIZE-sizeof(PageId))/(L_PAIR_SIZE));
+    //maxPairs is 84 for 1KB pages
+    int maxPairs=(pageSize-HEADER_SIZE)/L_PAIR_SIZE;
     return maxPairs;
 }
 
@@ -100,38 +232,27 @@ int BTLeafNode::getMaxKeys()
  * @return 0 if successful. Return an error code if the node is full.
  */
 RC BTLeafNode::insert(int key, const RecordId& rid)
-{ 
+{
+    int keyCount=getKeyCount();
+
     //if adding another key would go over the max key count return that
     //node is full
-    if(getKeyCount()+1>getMaxKeys())
+    if(keyCount+1>getMaxKeys())
         return RC_NODE_FULL;
 
-    //find the index of buffer where we want to insert
-    int insertIndex;
-    locate(key,insertIndex);
-  
-    //create a new buffer where we will copy everything to and zero it out
-    char* buffer2=(char*)malloc(PageFile::PAGE_SIZE);
-    memset(buffer2, '\0', PageFile::PAGE_SIZE);
+    //insert behind the keys that are not larger, so that entries
+    //with the same key stay in insertion order
+    int insertIndex=upperBound(key);
 
-    //copy buffer up to where we want to insert
-    if(insertIndex>=0)
-        memcpy(buffer2,buffer,insertIndex);
+    //shift the keys and rids after insertIndex over by one
+    memmove(keyPtr(insertIndex+1),keyPtr(insertIndex),(keyCount-insertIndex)*sizeof(int));
+    memmove(ridPtr(insertIndex+1),ridPtr(insertIndex),(keyCount-insertIndex)*sizeof(RecordId));
 
     //insert (key, rid) pair to buffer
-    memcpy(buffer2+insertIndex,&key,sizeof(int));
-    memcpy(buffer2+insertIndex+sizeof(int),&rid,sizeof(RecordId));
-
-    //copy the rest of the original buffer into buffer2
-    //this will include the PageId of the next node
-    memcpy(buffer2+insertIndex+sizeof(int)+sizeof(RecordId),buffer+insertIndex,(PageFile::PAGE_SIZE-insertIndex-sizeof(int)-sizeof(RecordId)));
-
-    //replace old buffer with new buffer(buffer2)
-    memcpy(buffer,buffer2,PageFile::PAGE_SIZE);
+    writeInt(keyPtr(insertIndex),key);
+    memcpy(ridPtr(insertIndex),&rid,sizeof(RecordId));
 
-    //free up buffer2
-    free(buffer2);
-    //if we reach here we are successful
+    writeInt(buffer+COUNT_OFFSET,keyCount+1);
     return 0;
 }
 
@@ -145,9 +266,9 @@ RC BTLeafNode::insert(int key, const RecordId& rid)
  * @param siblingKey[OUT] the first key in the sibling node after split.
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::insertAndSplit(int key, const RecordId& rid, 
+RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
                               BTLeafNode& sibling, int& siblingKey)
-{ 
+{
     int keyCount=getKeyCount();
 
     if(getMaxKeys()>keyCount+1)
@@ -157,48 +278,84 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
         return RC_INVALID_ATTRIBUTE;
 
     //find the index of buffer where we want to insert
-    int insertIndex;
-    locate(key,insertIndex);
+    int insertIndex=upperBound(key);
 
-    //create a new buffer where we will copy everything to and zero it out
-    char* buffer2=(char*)malloc(2*(PageFile::PAGE_SIZE));
-    memset(buffer2, '\0', (2*PageFile::PAGE_SIZE));
+    //all keyCount+1 pairs
+    vector<int> keys(keyCount+1);
+    vector<RecordId> rids(keyCount+1);
+    for(int i=0;i<keyCount;i++)
+    {
+        int j=(i<insertIndex) ? i : i+1;
+        keys[j]=readInt(keyPtr(i));
+        memcpy(&rids[j],ridPtr(i),sizeof(RecordId));
+    }
+    keys[insertIndex]=key;
+    rids[insertIndex]=rid;
 
-    //copy buffer up to where we want to insert
-    memcpy(buffer2,buffer,insertIndex);
+    //ceiling so the first node will have more than second
+    int first=(keyCount+2)/2;
+    int second=keyCount+1-first;
 
-    //insert (key, rid) pair to buffer
-    memcpy(buffer2+insertIndex,&key,sizeof(int));
-    memcpy(buffer2+insertIndex+sizeof(int),&rid,sizeof(RecordId));
-    
-    //copy the rest of the original buffer into buffer2
-    memcpy(buffer2+insertIndex+sizeof(int)+sizeof(RecordId),buffer+insertIndex,(PageFile::PAGE_SIZE-insertIndex));
+    //the sibling takes over the next node pointer
+    PageId next=getNextNodePtr();
+    sibling.fill(&keys[first],&rids[first],second,next);
+    fill(&keys[0],&rids[0],first,next);
 
-    //ceiling so the first node will have more than second
-    double dKey=keyCount+1;
-    double first=ceil((dKey)/2);
+    //copy first sibling key into siblingKey
+    siblingKey=keys[first];
 
-    int splitIndex=first*L_PAIR_SIZE;
+    return 0;
+}
 
-    //replace old buffer with new buffer
-    memcpy(buffer,buffer2,splitIndex);
+/*
+ * Replace the content of the node with count sorted (key, rid) pairs
+ * followed by the next sibling pointer.
+ * @param keys[IN] the keys, in sorted order
+ * @param rids[IN] the RecordIds belonging to the keys
+ * @param count[IN] the number of pairs
+ * @param next[IN] the PageId of the next sibling node
+ * @return 0 if successful. Return an error code if the pairs do not fit.
+ */
+RC BTLeafNode::fill(const int* keys, const RecordId* rids, int count, PageId next)
+{
+    if(count<0 || count>getMaxKeys())
+        return RC_NODE_FULL;
 
-    //replace sibling buffer with new buffer
-    memcpy(sibling.buffer,buffer2+splitIndex,PageFile::PAGE_SIZE+L_PAIR_SIZE-splitIndex);
+    //the node must be writable
+    pinned.unpin();
+    buffer=page;
+    memset(buffer, '\0', pageSize);
+    initHeader(buffer,0,true);
 
-    //zero out the rest of buffer
-    memset(buffer+splitIndex,'\0',PageFile::PAGE_SIZE-splitIndex);
+    //keys and rids are packed into their arrays
+    memcpy(keyPtr(0),keys,count*sizeof(int));
+    memcpy(ridPtr(0),rids,count*sizeof(RecordId));
 
-    //zero out the rest of sibling.buffer
-    memset(sibling.buffer+(PageFile::PAGE_SIZE+L_PAIR_SIZE-splitIndex),'\0',splitIndex-L_PAIR_SIZE);
+    writeInt(buffer+COUNT_OFFSET,count);
+    writeInt(buffer+NEXT_OFFSET,next);
+    return 0;
+}
 
-    //free the temp buffer
-    free(buffer2);
+/*
+ * Return the index of the first key that is larger than searchKey,
+ * or the key count if there is none.
+ * @param searchKey[IN] the key to search for.
+ * @return the index of the first larger key
+ */
+int BTLeafNode::upperBound(int searchKey)
+{
+    return upperBoundOf(keyPtr(0),getKeyCount(),searchKey);
+}
 
-    //copy first sibling key into siblingKey
-    memcpy(&siblingKey,sibling.buffer,sizeof(int));
-    
-    return 0; 
+/*
+ * Return the index of the first key that is not smaller than searchKey,
+ * or the key count if there is none.
+ * @param searchKey[IN] the key to search for.
+ * @return the index of the first key not smaller than searchKey
+ */
+int BTLeafNode::lowerBound(int searchKey)
+{
+    return lowerBoundOf(keyPtr(0),getKeyCount(),searchKey);
 }
 
 /**
@@ -213,36 +370,13 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
  * @return 0 if searchKey is found. Otherwise return an error code.
  */
 RC BTLeafNode::locate(int searchKey, int& eid)
-{ 
-    int i=0;
-    int keyCount=getKeyCount();
-    if(keyCount==0)
-    {
-        eid=i*L_PAIR_SIZE;
-        return RC_NO_SUCH_RECORD;
-    }
-
-    for(i=0;i<keyCount;i++)
-    {
-        int currKey;
-        memcpy(&currKey,buffer+(i*L_PAIR_SIZE),sizeof(int));
-       
-        if(searchKey==currKey)
-        {
-            eid=i*L_PAIR_SIZE;
-            return 0;
-        }
-        else if(searchKey<currKey)
-        {
-            eid=i*L_PAIR_SIZE;
-            return RC_NO_SUCH_RECORD;
-        }
-    }
-
+{
+    eid=lowerBound(searchKey);
+    if(eid<getKeyCount() && readInt(keyPtr(eid))==searchKey)
+        return 0;
 
-    eid=i*L_PAIR_SIZE;
-    //we did not find searchKey and there are no keys larger than it
-    return RC_NO_SUCH_RECORD; 
+    //we did not find searchKey
+    return RC_NO_SUCH_RECORD;
 }
 
 /*
@@ -253,52 +387,67 @@ RC BTLeafNode::locate(int searchKey, int& eid)
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
-{ 
+{
     if(eid<0)
         return RC_NO_SUCH_RECORD;
-    if(eid>=(getKeyCount()*L_PAIR_SIZE))
+    if(eid>=getKeyCount())
         return RC_NO_SUCH_RECORD;
 
-    int shift=eid;
-    memcpy(&key,buffer+shift,sizeof(int));
-    memcpy(&rid,buffer+shift+sizeof(int),sizeof(RecordId));
+    key=readInt(keyPtr(eid));
+    memcpy(&rid,ridPtr(eid),sizeof(RecordId));
 
     return 0;
 }
 
+/*
+ * Read up to max (key, rid) pairs starting from the eid entry.
+ * @param eid[IN] the entry number to start from
+ * @param keys[OUT] the keys of the entries
+ * @param rids[OUT] the RecordIds of the entries
+ * @param max[IN] the most entries to read
+ * @return the number of entries read. 0 if eid is at or past the last entry
+ */
+int BTLeafNode::readEntries(int eid, int* keys, RecordId* rids, int max)
+{
+    int n=getKeyCount()-eid;
+    if(eid<0 || n<=0)
+        return 0;
+    if(n>max)
+        n=max;
+
+    //both runs are copied at once
+    memcpy(keys,keyPtr(eid),n*sizeof(int));
+    memcpy(rids,ridPtr(eid),n*sizeof(RecordId));
+    return n;
+}
+
 /*
  * Return the pid of the next sibling node.
- * @return the PageId of the next sibling node 
+ * @return the PageId of the next sibling node
  */
 PageId BTLeafNode::getNextNodePtr()
-{ 
-    PageId pid;
-    memcpy(&pid, buffer+(getKeyCount()*L_PAIR_SIZE),sizeof(PageId));
-    return pid;
+{
+    return readInt(buffer+NEXT_OFFSET);
 }
 
 /*
  * Set the pid of the next sibling node.
- * @param pid[IN] the PageId of the next sibling node 
+ * @param pid[IN] the PageId of the next sibling node
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::setNextNodePtr(PageId pid)
 {
     if(pid<0)
         return RC_INVALID_PID;
-    memcpy(buffer+(getKeyCount()*L_PAIR_SIZE),&pid,sizeof(PageId));
+    writeInt(buffer+NEXT_OFFSET,pid);
     return 0;
 }
 
 void BTLeafNode::print()
 {
-    char* temp=buffer;
     for(int i=0;i<getKeyCount();i++)
     {
-        int tempInt;
-        memcpy(&tempInt,temp,sizeof(int));
-        cout<<"key: "<<tempInt<<endl;
-        temp+=L_PAIR_SIZE;
+        cout<<"key: "<<readInt(keyPtr(i))<<endl;
     }
 }
 
@@ -306,11 +455,55 @@ void BTLeafNode::print()
  *Constructor for BTNonLeafNode
  * initializes variables
  */
-BTNonLeafNode::BTNonLeafNode()
+BTNonLeafNode::BTNonLeafNode(int pageSize)
 {
     //zero out buffer
-    memset(buffer, '\0', PageFile::PAGE_SIZE);
-    memset(buffer,0,sizeof(int));
+    this->pageSize=pageSize;
+    page=new char[pageSize];
+    buffer=page;
+    memset(buffer, '\0', pageSize);
+    initHeader(buffer,1,false);
+}
+
+BTNonLeafNode::~BTNonLeafNode()
+{
+    pinned.unpin();
+    delete [] page;
+}
+
+/*
+ * Switch the node to pages of the given size, dropping its content
+ * if the size changes.
+ * @param size[IN] the page size
+ */
+void BTNonLeafNode::setPageSize(int size)
+{
+    if(size==pageSize)
+        return;
+    delete [] page;
+    pageSize=size;
+    page=new char[pageSize];
+    memset(page, '\0', pageSize);
+    initHeader(page,1,false);
+}
+
+/*
+ * Locate key i, child pointer i and subtree size i in the node.
+ */
+char* BTNonLeafNode::keyPtr(int i)
+{
+    return buffer+HEADER_SIZE+i*sizeof(int);
+}
+
+char* BTNonLeafNode::pidPtr(int i)
+{
+    return buffer+HEADER_SIZE+getMaxKeys()*sizeof(int)+i*sizeof(PageId);
+}
+
+char* BTNonLeafNode::sizePtr(int i)
+{
+    int n=getMaxKeys();
+    return buffer+HEADER_SIZE+n*sizeof(int)+(n+1)*sizeof(PageId)+i*sizeof(int);
 }
 
 /*
@@ -320,10 +513,29 @@ BTNonLeafNode::BTNonLeafNode()
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
-{ 
+{
+    pinned.unpin();
+    setPageSize(pf.getPageSize());
+    buffer=page;
     return pf.read(pid,buffer);
 }
-    
+
+/*
+ * Use the page pid in the PageFile pf as the content of the node
+ * without copying it.
+ * @param pid[IN] the PageId to pin
+ * @param pf[IN] PageFile to pin the page from
+ * @param sequential[IN] false if the node is not read in page order
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::pin(PageId pid, const PageFile& pf, bool sequential)
+{
+    RC rc=pf.pin(pid, pinned, sequential);
+    setPageSize(pf.getPageSize());
+    buffer=rc ? page : pinned.data();
+    return rc;
+}
+
 /*
  * Write the content of the node to the page pid in the PageFile pf.
  * @param pid[IN] the PageId to write to
@@ -331,7 +543,7 @@ RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::write(PageId pid, PageFile& pf)
-{ 
+{
     return pf.write(pid,buffer);
 }
 
@@ -340,70 +552,132 @@ RC BTNonLeafNode::write(PageId pid, PageFile& pf)
  * @return the number of keys in the node
  */
 int BTNonLeafNode::getKeyCount()
-{ 
-    int numKeys;
-    memcpy(&numKeys,buffer,sizeof(int));
-    return numKeys;
+{
+    return readInt(buffer+COUNT_OFFSET);
 }
 
 /*
  * Returns the maximum number of keys that can be stored in the node
- * @return the max keys that can be stored in the node 
+ * @return the max keys that can be stored in the node
  */
 int BTNonLeafNode::getMaxKeys()
 {
-    //maxPairs should be 127
-    //subtract sizeof numKeys and left pageid
-    int maxPairs=floor((PageFile::PAGE_SIZE-sizeof(int)-sizeof(PageId))/(NL_PAIR_SIZE));
-    return maxPairs-1;
+    //maxPairs is 83 for 1KB pages
+    //subtract the header and the left pageid and size,
+    //then every key comes with a pageid and a size
+    int maxPairs=(pageSize-HEADER_SIZE-sizeof(PageId)-sizeof(int))/(NL_PAIR_SIZE+sizeof(int));
+    return maxPairs;
+}
+
+/*
+ * Return the level of the node. The nodes right above the leaves are at level 1.
+ * @return the level of the node
+ */
+int BTNonLeafNode::getLevel()
+{
+    short lvl;
+    memcpy(&lvl,buffer+LEVEL_OFFSET,sizeof(short));
+    return lvl;
+}
+
+/*
+ * Set the level of the node.
+ * @param level[IN] the level of the node, 1 or more
+ */
+void BTNonLeafNode::setLevel(int level)
+{
+    short lvl=level;
+    memcpy(buffer+LEVEL_OFFSET,&lvl,sizeof(short));
+}
+
+/*
+ * Return the i'th child pointer of the node.
+ * @param i[IN] the child number, 0 to getKeyCount()
+ * @return the PageId of the child
+ */
+PageId BTNonLeafNode::getChildPtr(int i)
+{
+    return readInt(pidPtr(i));
+}
+
+/*
+ * Return the i'th key of the node.
+ * @param i[IN] the key number, 0 to getKeyCount()-1
+ * @return the key
+ */
+int BTNonLeafNode::getKey(int i)
+{
+    return readInt(keyPtr(i));
+}
+
+/*
+ * Return the number of index entries in the subtree of the i'th child.
+ * @param i[IN] the child number, 0 to getKeyCount()
+ * @return the number of entries
+ */
+int BTNonLeafNode::getSubtreeSize(int i)
+{
+    return readInt(sizePtr(i));
+}
+
+/*
+ * Set the number of index entries in the subtree of the i'th child.
+ * @param i[IN] the child number, 0 to getKeyCount()
+ * @param size[IN] the number of entries
+ */
+void BTNonLeafNode::setSubtreeSize(int i, int size)
+{
+    writeInt(sizePtr(i),size);
+}
+
+/*
+ * Return the number of index entries under the node.
+ * @return the number of entries
+ */
+int BTNonLeafNode::getSubtreeTotal()
+{
+    int total=0;
+    for(int i=0;i<=getKeyCount();i++)
+        total+=readInt(sizePtr(i));
+    return total;
 }
 
 /*
  * Insert a (key, pid) pair to the node.
  * @param key[IN] the key to insert
  * @param pid[IN] the PageId to insert
+ * @param eid[IN] the child number that the key goes behind, or -1 to
+ *                put it behind all keys that are not larger
+ * @param leftSize[IN] the # of entries now under the child in front of
+ *                     the key
+ * @param rightSize[IN] the # of entries under pid
  * @return 0 if successful. Return an error code if the node is full.
  */
-RC BTNonLeafNode::insert(int key, PageId pid)
-{ 
+RC BTNonLeafNode::insert(int key, PageId pid, int eid, int leftSize, int rightSize)
+{
     int numKeys=getKeyCount();
     //if adding another key would go over the max key count return that
     //node is full
     if(numKeys+1>getMaxKeys())
         return RC_NODE_FULL;
 
-    //find the index of buffer where we want to insert
-    int insertIndex;
-    locate(key,insertIndex);
-
-    //if key was found we will get index of key
-    //else we obtain the index of the first key that is larger
-    //we insert there and shift everything over
+    //the new pair goes behind the keys that are not larger
+    int insertIndex=(eid<0) ? upperBound(key) : eid;
 
-    //create a new buffer where we will copy everything to and zero it out
-    char* buffer2=(char*)malloc(PageFile::PAGE_SIZE);
-    memset(buffer2, '\0', PageFile::PAGE_SIZE);
-
-    //copy buffer up to where we want to insert
-    memcpy(buffer2,buffer,insertIndex);
+    //shift the keys, pids and sizes after insertIndex over by one
+    memmove(keyPtr(insertIndex+1),keyPtr(insertIndex),(numKeys-insertIndex)*sizeof(int));
+    memmove(pidPtr(insertIndex+2),pidPtr(insertIndex+1),(numKeys-insertIndex)*sizeof(PageId));
+    memmove(sizePtr(insertIndex+2),sizePtr(insertIndex+1),(numKeys-insertIndex)*sizeof(int));
 
     //insert (key, pid) pair to buffer
-    memcpy(buffer2+insertIndex,&key,sizeof(int));
-    memcpy(buffer2+insertIndex+sizeof(int),&pid,sizeof(PageId));
-
-    //copy the rest of the original buffer into buffer2
-    memcpy(buffer2+insertIndex+sizeof(int)+sizeof(PageId),buffer+insertIndex,(PageFile::PAGE_SIZE-insertIndex-sizeof(int)-sizeof(PageId)));
+    writeInt(keyPtr(insertIndex),key);
+    writeInt(pidPtr(insertIndex+1),pid);
+    writeInt(sizePtr(insertIndex),leftSize);
+    writeInt(sizePtr(insertIndex+1),rightSize);
 
-    //replace old buffer with new buffer(buffer2)
-    memcpy(buffer,buffer2,PageFile::PAGE_SIZE);
+    //update numKeys in the header
+    writeInt(buffer+COUNT_OFFSET,numKeys+1);
 
-    //free up buffer2
-    free(buffer2);
-
-    //set buffer's first 4 bytes to numKeys
-    numKeys++;
-    memcpy(buffer,&numKeys,sizeof(int));
-    
     //if we reach here we are successful
     return 0;
 }
@@ -416,18 +690,23 @@ RC BTNonLeafNode::insert(int key, PageId pid)
  * @param pid[IN] the PageId to insert
  * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
  * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+ * @param eid[IN] the child number that the key goes behind, or -1 to
+ *                put it behind all keys that are not larger
+ * @param leftSize[IN] the # of entries now under the child in front of
+ *                     the key
+ * @param rightSize[IN] the # of entries under pid
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey)
-{ 
+RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey, int eid,
+                                  int leftSize, int rightSize)
+{
     //steps:
-    //insert into node
-    //copy second half into sibling
-    //copy middle key to midKey and remove from the node
+    //insert into a temp copy of the node
+    //keep the first half here and copy second half into sibling
+    //the key in between goes to midKey and is removed from both
     //other functions will insert midKey and point it to sibling node
 
     //assumed that you call only when there is overflow
-    //implied that there is getMaxKeys() +1 keys
     //if node is not full return error
     int keyCount=getKeyCount();
 
@@ -438,68 +717,93 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
     if (sibling.getKeyCount()!=0)
         return RC_INVALID_ATTRIBUTE;
 
-    //find the index of buffer where we want to insert
-    int insertIndex;
-    locate(key,insertIndex);
-
-    //create a new buffer where we will copy everything to and zero it out
-    char* buffer2=(char*)malloc(2*(PageFile::PAGE_SIZE));
-    memset(buffer2, '\0', (2*PageFile::PAGE_SIZE));
-
-    //copy buffer up to where we want to insert
-    memcpy(buffer2,buffer,insertIndex);
+    int insertIndex=(eid<0) ? upperBound(key) : eid;
+
+    //all keyCount+1 keys and keyCount+2 pids and sizes
+    vector<int> keys(keyCount+1);
+    vector<PageId> pids(keyCount+2);
+    vector<int> sizes(keyCount+2);
+    for(int i=0;i<insertIndex;i++)
+        keys[i]=readInt(keyPtr(i));
+    keys[insertIndex]=key;
+    for(int i=insertIndex;i<keyCount;i++)
+        keys[i+1]=readInt(keyPtr(i));
+    for(int i=0;i<=insertIndex;i++)
+    {
+        pids[i]=readInt(pidPtr(i));
+        sizes[i]=getSubtreeSize(i);
+    }
+    pids[insertIndex+1]=pid;
+    sizes[insertIndex]=leftSize;
+    sizes[insertIndex+1]=rightSize;
+    for(int i=insertIndex+1;i<=keyCount;i++)
+    {
+        pids[i+1]=readInt(pidPtr(i));
+        sizes[i+1]=getSubtreeSize(i);
+    }
 
-    //insert (key, pid) pair to buffer
-    memcpy(buffer2+insertIndex,&key,sizeof(int));
-    memcpy(buffer2+insertIndex+sizeof(int),&pid,sizeof(PageId));
-    
-    //copy the rest of the original buffer into buffer2
-    memcpy(buffer2+insertIndex+sizeof(int)+sizeof(PageId),buffer+insertIndex,(PageFile::PAGE_SIZE-insertIndex));
- 
     //ceiling so the first node will have more than the second
-    double dKey=keyCount;
-
-    double first=ceil((dKey+1)/2);
-
-    //shift over due to the numKeys being placed at the start of the buffer
-    //buffer+splitIndex will be the start of the left pageid of the split key
-    int splitIndex=(first*NL_PAIR_SIZE)+sizeof(int);
-
-    //replace old buffer with new buffer
-    memcpy(buffer,buffer2,splitIndex);
+    //keys 0..first-2 stay, key first-1 moves up, the rest go to sibling
+    int first=(keyCount+2)/2;
+    midKey=keys[first-1];
 
-    //replace sibling buffer with new buffer
-    memcpy(sibling.buffer+sizeof(int),buffer2+splitIndex,PageFile::PAGE_SIZE+NL_PAIR_SIZE-splitIndex);
-    
-    //zero out the rest of buffer
-    memset(buffer+splitIndex,'\0',PageFile::PAGE_SIZE-splitIndex);
+    int level=getLevel();
+    fill(&keys[0],&pids[0],first-1,&sizes[0]);
+    setLevel(level);
+    sibling.fill(&keys[first],&pids[first],keyCount-first+1,&sizes[first]);
+    sibling.setLevel(level);
 
-    //zero out the rest of sibling.buffer
-    memset(sibling.buffer+(PageFile::PAGE_SIZE+NL_PAIR_SIZE-splitIndex+sizeof(PageId)),'\0',splitIndex-NL_PAIR_SIZE-sizeof(PageId));
-
-    //set sibling's numKey
-    int siblingNumKey=keyCount+1-first;
-    memcpy(sibling.buffer,&siblingNumKey,sizeof(int));
-
-    //set node's new numKey
-    int newKey=first-1;
-    memcpy(buffer,&newKey,sizeof(int));
-
-    //free the temp buffer
-    free(buffer2);
+    return 0;
+}
 
-    //Now that we have split and inserted, we need to set midKey
-    //and remove it from the node
+/*
+ * Replace the content of the node with count sorted keys and the
+ * count+1 child pointers around them.
+ * @param keys[IN] the keys, in sorted order
+ * @param pids[IN] the child PageIds. pids[i] comes before keys[i]
+ * @param count[IN] the number of keys
+ * @param sizes[IN] the # of entries under each child
+ * @return 0 if successful. Return an error code if the keys do not fit.
+ */
+RC BTNonLeafNode::fill(const int* keys, const PageId* pids, int count, const int* sizes)
+{
+    if(count<0 || count>getMaxKeys())
+        return RC_NODE_FULL;
 
-    //set midKey
-    int midKeyPos=sizeof(int)+((first-1)*NL_PAIR_SIZE)+sizeof(PageId);
-    memcpy(&midKey,buffer+midKeyPos,sizeof(int));
+    //the node must be writable
+    pinned.unpin();
+    buffer=page;
+    memset(buffer, '\0', pageSize);
+    initHeader(buffer,1,false);
+
+    //keys, pids and sizes are packed into their arrays
+    writeInt(buffer+COUNT_OFFSET,count);
+    memcpy(keyPtr(0),keys,count*sizeof(int));
+    memcpy(pidPtr(0),pids,(count+1)*sizeof(PageId));
+    memcpy(sizePtr(0),sizes,(count+1)*sizeof(int));
+    return 0;
+}
 
-    //remove midKey from the node. It shouldn't have a pageid next to it
-    //because we should have given that to sibling
-    memset(buffer+midKeyPos,'\0',sizeof(int));
+/*
+ * Return the index of the first key that is larger than searchKey,
+ * or the key count if there is none.
+ * @param searchKey[IN] the key to search for.
+ * @return the index of the first larger key
+ */
+int BTNonLeafNode::upperBound(int searchKey)
+{
+    return upperBoundOf(keyPtr(0),getKeyCount(),searchKey);
+}
 
-    return 0;
+/*
+ * Return the index of the first key that is not smaller than searchKey,
+ * or the key count if there is none.
+ * @param searchKey[IN] the key to search for.
+ * @return the index of the first key not smaller than searchKey
+ */
+int BTNonLeafNode::lowerBound(int searchKey)
+{
+    return lowerBoundOf(keyPtr(0),getKeyCount(),searchKey);
 }
 
 /**
@@ -514,41 +818,12 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
  * @return 0 if searchKey is found. Otherwise return an error code.
  */
 RC BTNonLeafNode::locate(int searchKey, int& eid)
-{ 
-    //this will give us the index in buffer of the key
-    //to obtain the pageid we shift over.
-    int i;
-
-    for(i=0;i<getKeyCount();i++)
-    {
-        int currKey;
-        //starting pos shifted by pageid and the 4 bytes that store the number of keys
-        //and the pairs we already went through
-        memcpy(&currKey,buffer+(i*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int),sizeof(int));
-        if(searchKey==currKey)
-        {
-            eid=(i*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int);
-            return 0;
-        }
-        else if(searchKey<currKey)
-        {
-            eid=(i*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int);
-            return RC_NO_SUCH_RECORD;
-        }
-    }
-    //if still room in the node, return index of open space
-    if(i<getMaxKeys())
-    {
-        eid=(i*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int);
-        return RC_NO_SUCH_RECORD;
-    }
-
-    //no more room in node
-    //we did not find searchKey and there are no keys larger than it 
-    //we set eid to the index to insert at, the index
-    eid=((i)*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int);
+{
+    eid=lowerBound(searchKey);
+    if(eid<getKeyCount() && readInt(keyPtr(eid))==searchKey)
+        return 0;
 
-    return RC_NO_SUCH_RECORD; 
+    return RC_NO_SUCH_RECORD;
 }
 
 /*
@@ -559,36 +834,30 @@ RC BTNonLeafNode::locate(int searchKey, int& eid)
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
-{ 
-    //numKeys,pageid,key,pageid,key,...pageid
-    int tmpKey;
-    PageId tmpPid;
-    int i;
-
-    int numKeys=getKeyCount();
-    for(i=0;i<numKeys;i++)
-    {
-        memcpy(&tmpKey,buffer+(i*NL_PAIR_SIZE)+sizeof(PageId)+sizeof(int),sizeof(int));
-        //if searchKey < tmpKey we take pid to the left of tmpKey
-        if(searchKey<tmpKey)
-        {
-            memcpy(&tmpPid,buffer+(i*NL_PAIR_SIZE)+sizeof(int),sizeof(PageId));
-            pid=tmpPid;
-            return 0;
-        }
-        //if we are on the last key we shift to the last pid
-        //if we are on the last key and reach here, searchKey must be > all keys in
-        //the node
-        if(i==numKeys-1)
-        {
-            memcpy(&tmpPid,buffer+((i+1)*NL_PAIR_SIZE)+sizeof(int),sizeof(PageId));
-            pid=tmpPid;
-            return 0;
-        }
-    }
+{
+    int eid;
+    return locateChildPtr(searchKey,pid,eid);
+}
 
+/*
+ * Given the searchKey, find the child-node pointer to follow and
+ * output it in pid and its child number in eid.
+ * @param searchKey[IN] the searchKey that is being looked up.
+ * @param pid[OUT] the pointer to the child node to follow.
+ * @param eid[OUT] the child number of pid.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid, int& eid)
+{
+    if(getKeyCount()==0)
+        return RC_NO_SUCH_RECORD;
 
-    return RC_NO_SUCH_RECORD;
+    //the child to the left of the first key not smaller than searchKey.
+    //a key equal to searchKey may start a run of duplicates that began
+    //in that child already. if no key is that large, this is the last pid
+    eid=lowerBound(searchKey);
+    pid=getChildPtr(eid);
+    return 0;
 }
 
 /*
@@ -596,37 +865,24 @@ RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
  * @param pid1[IN] the first PageId to insert
  * @param key[IN] the key that should be inserted between the two PageIds
  * @param pid2[IN] the PageId to insert behind the key
+ * @param size1[IN] the # of entries under pid1
+ * @param size2[IN] the # of entries under pid2
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
-{ 
-    //zero out everything
-    memset(buffer, '\0', PageFile::PAGE_SIZE);
-
+RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2, int size1, int size2)
+{
     //new roots only have 1 key
-    int numKeys=1;
-    memcpy(buffer,&numKeys,sizeof(int));
-
-    //insert root's pids and key
-    //numKeys,pid,key,pid
-    memcpy(buffer+sizeof(int),&pid1,sizeof(PageId));
-    memcpy(buffer+sizeof(int)+sizeof(PageId),&key,sizeof(int));
-    memcpy(buffer+sizeof(int)+sizeof(PageId)+sizeof(int),&pid2,sizeof(PageId));
-
-    return 0;
+    PageId pids[2]={pid1,pid2};
+    int sizes[2]={size1,size2};
+    return fill(&key,pids,1,sizes);
 }
 
 void BTNonLeafNode::print()
 {
-    return;
-    char* temp=buffer;
-    int keyss=getKeyCount();
-    for(int i=0;i<1024;i+=sizeof(int))
+    cout<<"level "<<getLevel()<<":";
+    for(int i=0;i<getKeyCount();i++)
     {
-        int tempInt;
-        memcpy(&tempInt,temp,sizeof(int));
-        cout<<tempInt<<" ";
-        temp+=sizeof(int);
+        cout<<" "<<readInt(keyPtr(i));
     }
     cout<<endl;
-}
\ No newline at end of file
+}
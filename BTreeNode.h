@@ -13,13 +13,31 @@
 #include "RecordFile.h"
 #include "PageFile.h"
 
+/**
+ * Every node page starts with a header holding the key count, the level
+ * of the node (0 for leaves), flags that mark the page as a leaf or
+ * nonleaf node, and the next sibling pointer of a leaf. The entries
+ * follow the header. A node keeps all keys in one array and the rids
+ * or child pointers in a second one.
+ */
+
+/**
+ * Read the level of the node stored in a page. Leaves are at level 0.
+ * @param page[IN] the content of the page
+ * @param level[OUT] the level of the node
+ * @return 0 if successful. RC_INVALID_FILE_FORMAT if the page does not
+ *         hold a node.
+ */
+RC readNodeLevel(const char* page, int& level);
+
 /**
  * BTLeafNode: The class representing a B+tree leaf node.
  */
 class BTLeafNode {
   public:
-    //leaf node constructor
-    BTLeafNode();
+    //leaf node constructor, for a node of pageSize bytes
+    BTLeafNode(int pageSize=PageFile::DEFAULT_PAGE_SIZE);
+    ~BTLeafNode();
 
    /**
     * Insert the (key, rid) pair to the node.
@@ -43,6 +61,18 @@ class BTLeafNode {
     */
     RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
 
+   /**
+    * Replace the content of the node with count sorted (key, rid) pairs
+    * followed by the next sibling pointer. Used to build packed leaves
+    * during bulk loading.
+    * @param keys[IN] the keys, in sorted order
+    * @param rids[IN] the RecordIds belonging to the keys
+    * @param count[IN] the number of pairs
+    * @param next[IN] the PageId of the next sibling node
+    * @return 0 if successful. Return an error code if the pairs do not fit.
+    */
+    RC fill(const int* keys, const RecordId* rids, int count, PageId next);
+
    /**
     * If searchKey exists in the node, set eid to the index entry
     * with searchKey and return 0. If not, set eid to the index entry
@@ -65,6 +95,16 @@ class BTLeafNode {
     */
     RC readEntry(int eid, int& key, RecordId& rid);
 
+   /**
+    * Read up to max (key, rid) pairs starting from the eid entry.
+    * @param eid[IN] the entry number to start from
+    * @param keys[OUT] the keys of the entries
+    * @param rids[OUT] the RecordIds of the entries
+    * @param max[IN] the most entries to read
+    * @return the number of entries read. 0 if eid is at or past the last entry
+    */
+    int readEntries(int eid, int* keys, RecordId* rids, int max);
+
    /**
     * Return the pid of the next slibling node.
     * @return the PageId of the next sibling node 
@@ -93,11 +133,26 @@ class BTLeafNode {
 
    /**
     * Read the content of the node from the page pid in the PageFile pf.
+    * The node takes the page size of pf.
     * @param pid[IN] the PageId to read
     * @param pf[IN] PageFile to read from
     * @return 0 if successful. Return an error code if there is an error.
     */
     RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Use the page pid in the PageFile pf as the content of the node
+    * without copying it out of the buffer pool. The node must not be
+    * modified while it is pinned; use read() to get a private copy.
+    * The pin is released by the next read() or pin(), or when the node
+    * is destroyed.
+    * @param pid[IN] the PageId to pin
+    * @param pf[IN] PageFile to pin the page from
+    * @param sequential[IN] false if the node is not read in page order,
+    *        so that the read does not start a read-ahead
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC pin(PageId pid, const PageFile& pf, bool sequential = true);
     
    /**
     * Write the content of the node to the page pid in the PageFile pf.
@@ -113,11 +168,36 @@ class BTLeafNode {
         return buffer;
     }
   private:
+    //switch the node to pages of the given size
+    void setPageSize(int size);
+
+    //binary search: index of the first key >= searchKey / > searchKey
+    int lowerBound(int searchKey);
+    int upperBound(int searchKey);
+
+    //the key and the rid of entry i in the node
+    char* keyPtr(int i);
+    char* ridPtr(int i);
+
+   /**
+    * The content of the node. It points either to page or,
+    * while the node is pinned, to the buffer pool frame of the disk page.
+    */
+    char* buffer;
+
    /**
     * The main memory buffer for loading the content of the disk page 
     * that contains the node.
     */
-    char buffer[PageFile::PAGE_SIZE];
+    char* page;
+
+   /**
+    * The size of the node in bytes. It is the page size of the PageFile
+    * that holds the node.
+    */
+    int pageSize;
+
+    PinnedPage pinned;
 }; 
 
 
@@ -127,15 +207,24 @@ class BTLeafNode {
 class BTNonLeafNode {
   public:
 
-    BTNonLeafNode();
+    //nonleaf node constructor, for a node of pageSize bytes
+    BTNonLeafNode(int pageSize=PageFile::DEFAULT_PAGE_SIZE);
+    ~BTNonLeafNode();
    /**
     * Insert a (key, pid) pair to the node.
     * Remember that all keys inside a B+tree node should be kept sorted.
     * @param key[IN] the key to insert
     * @param pid[IN] the PageId to insert
+    * @param eid[IN] the child number that the key goes behind, or -1 to
+    *                put it behind all keys that are not larger. A split
+    *                child passes its own child number, since with duplicate
+    *                keys the key alone does not tell where it belongs.
+    * @param leftSize[IN] the # of entries now under the child in front of
+    *                     the key
+    * @param rightSize[IN] the # of entries under pid
     * @return 0 if successful. Return an error code if the node is full.
     */
-    RC insert(int key, PageId pid);
+    RC insert(int key, PageId pid, int eid, int leftSize, int rightSize);
 
    /**
     * Insert the (key, pid) pair to the node
@@ -147,9 +236,27 @@ class BTNonLeafNode {
     * @param pid[IN] the PageId to insert
     * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
     * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+    * @param eid[IN] the child number that the key goes behind, or -1 to
+    *                put it behind all keys that are not larger
+    * @param leftSize[IN] the # of entries now under the child in front of
+    *                     the key
+    * @param rightSize[IN] the # of entries under pid
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
+    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey, int eid,
+                      int leftSize, int rightSize);
+
+   /**
+    * Replace the content of the node with count sorted keys and the
+    * count+1 child pointers around them. Used to build packed nodes
+    * during bulk loading.
+    * @param keys[IN] the keys, in sorted order
+    * @param pids[IN] the child PageIds. pids[i] comes before keys[i]
+    * @param count[IN] the number of keys
+    * @param sizes[IN] the # of entries under each child
+    * @return 0 if successful. Return an error code if the keys do not fit.
+    */
+    RC fill(const int* keys, const PageId* pids, int count, const int* sizes);
 
    /**
     * Given the searchKey, find the child-node pointer to follow and
@@ -161,14 +268,26 @@ class BTNonLeafNode {
     */
     RC locateChildPtr(int searchKey, PageId& pid);
 
+   /**
+    * Given the searchKey, find the child-node pointer to follow and
+    * output it in pid and its child number in eid.
+    * @param searchKey[IN] the searchKey that is being looked up.
+    * @param pid[OUT] the pointer to the child node to follow.
+    * @param eid[OUT] the child number of pid.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC locateChildPtr(int searchKey, PageId& pid, int& eid);
+
    /**
     * Initialize the root node with (pid1, key, pid2).
     * @param pid1[IN] the first PageId to insert
     * @param key[IN] the key that should be inserted between the two PageIds
     * @param pid2[IN] the PageId to insert behind the key
+    * @param size1[IN] the # of entries under pid1
+    * @param size2[IN] the # of entries under pid2
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC initializeRoot(PageId pid1, int key, PageId pid2);
+    RC initializeRoot(PageId pid1, int key, PageId pid2, int size1, int size2);
 
    /**
     * Return the number of keys stored in the node.
@@ -182,6 +301,53 @@ class BTNonLeafNode {
     */
     int getMaxKeys();
 
+   /**
+    * Return the level of the node. Leaves are at level 0, so the nodes
+    * right above them are at level 1 and the root is at treeHeight-1.
+    * @return the level of the node
+    */
+    int getLevel();
+
+   /**
+    * Set the level of the node.
+    * @param level[IN] the level of the node, 1 or more
+    */
+    void setLevel(int level);
+
+   /**
+    * Return the i'th child pointer of the node.
+    * @param i[IN] the child number, 0 to getKeyCount()
+    * @return the PageId of the child
+    */
+    PageId getChildPtr(int i);
+
+   /**
+    * Return the i'th key of the node.
+    * @param i[IN] the key number, 0 to getKeyCount()-1
+    * @return the key
+    */
+    int getKey(int i);
+
+   /**
+    * Return the number of index entries in the subtree of the i'th child.
+    * @param i[IN] the child number, 0 to getKeyCount()
+    * @return the number of entries
+    */
+    int getSubtreeSize(int i);
+
+   /**
+    * Set the number of index entries in the subtree of the i'th child.
+    * @param i[IN] the child number, 0 to getKeyCount()
+    * @param size[IN] the number of entries
+    */
+    void setSubtreeSize(int i, int size);
+
+   /**
+    * Return the number of index entries under the node.
+    * @return the number of entries
+    */
+    int getSubtreeTotal();
+
     /**
     * If searchKey exists in the node, set eid to the index entry
     * with searchKey and return 0. If not, set eid to the index entry
@@ -198,11 +364,26 @@ class BTNonLeafNode {
 
    /**
     * Read the content of the node from the page pid in the PageFile pf.
+    * The node takes the page size of pf.
     * @param pid[IN] the PageId to read
     * @param pf[IN] PageFile to read from
     * @return 0 if successful. Return an error code if there is an error.
     */
     RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Use the page pid in the PageFile pf as the content of the node
+    * without copying it out of the buffer pool. The node must not be
+    * modified while it is pinned; use read() to get a private copy.
+    * The pin is released by the next read() or pin(), or when the node
+    * is destroyed.
+    * @param pid[IN] the PageId to pin
+    * @param pf[IN] PageFile to pin the page from
+    * @param sequential[IN] false if the node is not read in page order,
+    *        so that the read does not start a read-ahead
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC pin(PageId pid, const PageFile& pf, bool sequential = true);
     
    /**
     * Write the content of the node to the page pid in the PageFile pf.
@@ -218,11 +399,37 @@ class BTNonLeafNode {
     }
     void print();
   private:
+    //switch the node to pages of the given size
+    void setPageSize(int size);
+
+    //binary search: index of the first key >= searchKey / > searchKey
+    int lowerBound(int searchKey);
+    int upperBound(int searchKey);
+
+    //key i, child pointer i and subtree size i in the layout of the node
+    char* keyPtr(int i);
+    char* pidPtr(int i);
+    char* sizePtr(int i);
+
+   /**
+    * The content of the node. It points either to page or,
+    * while the node is pinned, to the buffer pool frame of the disk page.
+    */
+    char* buffer;
+
    /**
     * The main memory buffer for loading the content of the disk page 
     * that contains the node.
     */
-    char buffer[PageFile::PAGE_SIZE];
+    char* page;
+
+   /**
+    * The size of the node in bytes. It is the page size of the PageFile
+    * that holds the node.
+    */
+    int pageSize;
+
+    PinnedPage pinned;
 }; 
 
 #endif /* BTREENODE_H */
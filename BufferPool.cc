@@ -0,0 +1,601 @@
+#include "Bruinbase.h"
+#include "BufferPool.h"
+#include "AsyncIO.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <climits>
+#include <strings.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+using std::list;
+using std::make_pair;
+using std::vector;
+
+typedef std::lock_guard<std::mutex> Guard;
+
+BufferPool::BufferPool()
+{
+  policy = CLOCK;
+  hitCount = missCount = evictionCount = 0;
+  writeCount = writeCallCount = 0;
+  for (int i = 0; i < SHARD_COUNT; i++) {
+    shards[i].capacity = 0;
+    shards[i].usedBytes = 0;
+    shards[i].clockHand = 0;
+    shards[i].tick = 0;
+  }
+  setSize(DEFAULT_SIZE_MB);
+}
+
+BufferPool::~BufferPool()
+{
+  flushAll();
+  clear();
+}
+
+RC BufferPool::setSize(int megabytes)
+{
+  RC rc;
+  if (megabytes <= 0) return RC_INVALID_ATTRIBUTE;
+
+  if ((rc = flushAll()) < 0) return rc;
+  clear();
+
+  // the memory is divided evenly among the shards
+  for (int i = 0; i < SHARD_COUNT; i++) {
+    shards[i].capacity = ((long)megabytes << 20) / SHARD_COUNT;
+  }
+  return 0;
+}
+
+RC BufferPool::setPolicy(Policy policy)
+{
+  RC rc;
+
+  if ((rc = flushAll()) < 0) return rc;
+  clear();
+  this->policy = policy;
+  return 0;
+}
+
+RC BufferPool::parsePolicy(const char* name, Policy& policy)
+{
+  if (strcasecmp(name, "clock") == 0) policy = CLOCK;
+  else if (strcasecmp(name, "lru2") == 0) policy = LRU2;
+  else if (strcasecmp(name, "2q") == 0) policy = TWO_Q;
+  else return RC_INVALID_ATTRIBUTE;
+  return 0;
+}
+
+void BufferPool::clear()
+{
+  for (int s = 0; s < SHARD_COUNT; s++) {
+    Shard& shard = shards[s];
+    Guard guard(shard.lock);
+
+    for (unsigned i = 0; i < shard.frames.size(); i++) {
+      delete [] shard.frames[i].buffer;
+    }
+    shard.frames.clear();
+    shard.freeFrames.clear();
+    shard.usedBytes = 0;
+    shard.table.clear();
+    shard.dirtyPages.clear();
+    shard.lru2Order.clear();
+    shard.a1in.clear();
+    shard.am.clear();
+    shard.a1out.clear();
+    shard.a1outIndex.clear();
+    shard.clockHand = 0;
+  }
+}
+
+RC BufferPool::pin(int fd, PageId pid, int size, bool load, char*& frame, bool& loaded)
+{
+  Shard& shard = shards[shardOf(fd, pid)];
+  Guard guard(shard.lock);
+
+  loaded = false;
+
+  // use the cached frame if the page is already in the pool
+  std::unordered_map<FrameKey, int>::iterator it = shard.table.find(makeKey(fd, pid));
+  if (it != shard.table.end()) {
+    if (load) hitCount++;
+    touch(shard, it->second, false);
+    shard.frames[it->second].pinCount++;
+    frame = shard.frames[it->second].buffer;
+    return 0;
+  }
+
+  // get a frame, evicting a page if necessary
+  if (load) missCount++;
+  int f = allocate(shard, fd, pid, size);
+  if (f < 0) return RC_FILE_WRITE_FAILED;
+
+  // read the page into the frame. the shard stays locked, so that no other
+  // thread can see the frame before its content is there.
+  if (load) {
+    if (::pread(fd, shard.frames[f].buffer, size, (off_t)pid * size) < 0) {
+      release(shard, f);
+      return RC_FILE_READ_FAILED;
+    }
+    loaded = true;
+  }
+
+  shard.frames[f].pinCount = 1;
+  frame = shard.frames[f].buffer;
+  return 0;
+}
+
+bool BufferPool::copyCached(int fd, PageId pid, void* buffer)
+{
+  Shard& shard = shards[shardOf(fd, pid)];
+  Guard guard(shard.lock);
+
+  std::unordered_map<FrameKey, int>::iterator it = shard.table.find(makeKey(fd, pid));
+  if (it == shard.table.end()) return false;
+
+  hitCount++;
+  touch(shard, it->second, false);
+  memcpy(buffer, shard.frames[it->second].buffer, shard.frames[it->second].size);
+  return true;
+}
+
+int BufferPool::prefetch(int fd, PageId first, int count, int size)
+{
+  struct iovec iov[IOV_MAX];
+  int    loaded = 0;
+  PageId end = first + count;
+  PageId pid = first;
+
+  while (pid < end) {
+    // the pages up to the next shard run boundary are in the same shard
+    PageId runEnd = (pid / SHARD_RUN + 1) * SHARD_RUN;
+    if (runEnd > end) runEnd = end;
+
+    Shard& shard = shards[shardOf(fd, pid)];
+    Guard guard(shard.lock);
+
+    while (pid < runEnd) {
+      // skip the pages already in the pool
+      if (shard.table.count(makeKey(fd, pid)) > 0) { pid++; continue; }
+
+      // reserve frames for the run of uncached pages starting at pid.
+      // the frames are pinned, so that they do not evict each other.
+      vector<int> run;
+      PageId start = pid;
+      while (pid < runEnd && (int)run.size() < IOV_MAX &&
+             shard.table.count(makeKey(fd, pid)) == 0) {
+        int f = allocate(shard, fd, pid, size);
+        if (f < 0) break;
+        shard.frames[f].pinCount = 1;
+        iov[run.size()].iov_base = shard.frames[f].buffer;
+        iov[run.size()].iov_len = size;
+        run.push_back(f);
+        pid++;
+      }
+
+      // read the whole run at once
+      bool ok = !run.empty() && ::preadv(fd, iov, run.size(), (off_t)start * size) >= 0;
+      for (unsigned i = 0; i < run.size(); i++) {
+        shard.frames[run[i]].pinCount = 0;
+        if (!ok) release(shard, run[i]);
+      }
+      if (!ok) return (loaded > 0) ? loaded : RC_FILE_READ_FAILED;
+      loaded += run.size();
+    }
+  }
+
+  return loaded;
+}
+
+void BufferPool::unpin(int fd, PageId pid, bool dirty)
+{
+  Shard& shard = shards[shardOf(fd, pid)];
+  Guard guard(shard.lock);
+
+  std::unordered_map<FrameKey, int>::iterator it = shard.table.find(makeKey(fd, pid));
+  if (it == shard.table.end()) return;
+
+  Frame& frame = shard.frames[it->second];
+  if (dirty) {
+    if (!frame.dirty) {
+      frame.dirty = true;
+      shard.dirtyPages.insert(it->first);
+    }
+    frame.dirtySeq++;
+  }
+  if (frame.pinCount > 0) frame.pinCount--;
+}
+
+int BufferPool::allocate(Shard& shard, int fd, PageId pid, int size)
+{
+  int f = -1;
+
+  // a free frame of the same size is used as it is
+  for (unsigned i = 0; i < shard.freeFrames.size(); i++) {
+    if (shard.frames[shard.freeFrames[i]].size == size) {
+      f = shard.freeFrames[i];
+      shard.freeFrames.erase(shard.freeFrames.begin() + i);
+      break;
+    }
+  }
+
+  // otherwise make room for the page, giving up the buffers of free
+  // frames first and then evicting victims. a victim of the same size
+  // is reused. the shard grows beyond its capacity only when every
+  // frame is pinned.
+  if (f < 0) {
+    for (unsigned i = 0; i < shard.freeFrames.size(); i++) {
+      dropBuffer(shard, shard.freeFrames[i]);
+    }
+    while (shard.usedBytes + size > shard.capacity) {
+      int v = pickVictim(shard);
+      if (v < 0) break;
+      if (evict(shard, v) < 0) return -1;
+      if (shard.frames[v].size == size) { f = v; break; }
+      dropBuffer(shard, v);
+      shard.freeFrames.push_back(v);
+    }
+  }
+  if (f < 0) {
+    if (!shard.freeFrames.empty()) {
+      f = shard.freeFrames.back();
+      shard.freeFrames.pop_back();
+    } else {
+      Frame frame;
+      frame.buffer = NULL;
+      frame.size = 0;
+      shard.frames.push_back(frame);
+      f = shard.frames.size() - 1;
+    }
+    shard.frames[f].buffer = new char[size];
+    shard.frames[f].size = size;
+    shard.usedBytes += size;
+  }
+
+  Frame& frame = shard.frames[f];
+  frame.fd = fd;
+  frame.pid = pid;
+  frame.pinCount = 0;
+  frame.dirty = false;
+  frame.dirtySeq = 0;
+  shard.table[makeKey(fd, pid)] = f;
+  touch(shard, f, true);
+
+  return f;
+}
+
+RC BufferPool::evict(Shard& shard, int f)
+{
+  RC rc;
+  Frame& victim = shard.frames[f];
+
+  // write back the victim, together with the other dirty pages of
+  // its file in this shard, before the frame is reused
+  if (victim.dirty && (rc = flushShard(shard, victim.fd)) < 0) return rc;
+  shard.table.erase(makeKey(victim.fd, victim.pid));
+  forget(shard, f);
+  victim.fd = -1;
+  evictionCount++;
+  return 0;
+}
+
+void BufferPool::release(Shard& shard, int f)
+{
+  Frame& frame = shard.frames[f];
+  FrameKey key = makeKey(frame.fd, frame.pid);
+
+  shard.table.erase(key);
+  if (frame.dirty) shard.dirtyPages.erase(key);
+  forget(shard, f);
+  frame.fd = -1;
+  shard.freeFrames.push_back(f);
+}
+
+void BufferPool::dropBuffer(Shard& shard, int f)
+{
+  Frame& frame = shard.frames[f];
+
+  shard.usedBytes -= frame.size;
+  delete [] frame.buffer;
+  frame.buffer = NULL;
+  frame.size = 0;
+}
+
+//
+// write-back of dirty pages
+//
+
+RC BufferPool::writeRuns(int fd, int size, vector<DirtyPage>& pages)
+{
+  AsyncIO& io = AsyncIO::engine();
+  vector<struct iovec> iov(pages.size());
+  vector<AsyncIO::Handle> handles;
+  vector<ssize_t> lengths;
+  RC     rc = 0;
+  int    n = 0;
+  PageId first = 0;
+
+  // pages are sorted by PageId. every run of adjacent pages is written
+  // with a single vectored write, and all runs are in flight together.
+  for (unsigned i = 0; i <= pages.size(); i++) {
+    bool more = (i < pages.size());
+
+    if (n > 0 && (!more || pages[i].pid != first + n || n == IOV_MAX)) {
+      AsyncIO::Handle h = io.writev(fd, &iov[i - n], n, (off_t)first * size);
+      if (h < 0) { rc = RC_FILE_WRITE_FAILED; break; }
+      handles.push_back(h);
+      lengths.push_back((ssize_t)n * size);
+      n = 0;
+    }
+    if (!more) break;
+
+    if (n == 0) first = pages[i].pid;
+    iov[i].iov_base = pages[i].buffer;
+    iov[i].iov_len = size;
+    n++;
+  }
+
+  // every started write must be waited for, as it uses iov
+  for (unsigned i = 0; i < handles.size(); i++) {
+    if (io.wait(handles[i]) != lengths[i]) rc = RC_FILE_WRITE_FAILED;
+    else {
+      writeCount += lengths[i] / size;
+      writeCallCount++;
+    }
+  }
+
+  return rc;
+}
+
+RC BufferPool::flushShard(Shard& shard, int fd)
+{
+  RC rc;
+  int size = 0;
+  vector<DirtyPage> pages;
+
+  // shard.dirtyPages is ordered by (fd, pid), so the dirty pages of fd
+  // form a contiguous range in PageId order
+  std::set<FrameKey>::iterator begin = shard.dirtyPages.lower_bound(makeKey(fd, 0));
+  std::set<FrameKey>::iterator it;
+  for (it = begin; it != shard.dirtyPages.end() && (int)(*it >> 32) == fd; ++it) {
+    DirtyPage page;
+    page.pid = (PageId)(unsigned)*it;
+    page.buffer = shard.frames[shard.table[*it]].buffer;
+    size = shard.frames[shard.table[*it]].size;
+    pages.push_back(page);
+  }
+
+  if ((rc = writeRuns(fd, size, pages)) < 0) return rc;
+
+  // every page in the range has been written back
+  for (it = begin; it != shard.dirtyPages.end() && (int)(*it >> 32) == fd; ++it) {
+    shard.frames[shard.table[*it]].dirty = false;
+  }
+  shard.dirtyPages.erase(begin, it);
+
+  return 0;
+}
+
+RC BufferPool::flushFile(int fd)
+{
+  RC rc;
+  int size = 0;
+  vector<DirtyPage> pages;
+
+  // pick up the dirty pages of fd from every shard, pinning them
+  // so that they stay in place while they are written
+  for (int s = 0; s < SHARD_COUNT; s++) {
+    Shard& shard = shards[s];
+    Guard guard(shard.lock);
+
+    std::set<FrameKey>::iterator it = shard.dirtyPages.lower_bound(makeKey(fd, 0));
+    for (; it != shard.dirtyPages.end() && (int)(*it >> 32) == fd; ++it) {
+      DirtyPage page;
+      page.frame = shard.table[*it];
+      page.shard = s;
+      page.pid = (PageId)(unsigned)*it;
+      page.buffer = shard.frames[page.frame].buffer;
+      page.seq = shard.frames[page.frame].dirtySeq;
+      size = shard.frames[page.frame].size;
+      shard.frames[page.frame].pinCount++;
+      pages.push_back(page);
+    }
+  }
+
+  // write them in PageId order without holding any lock
+  std::sort(pages.begin(), pages.end());
+  rc = writeRuns(fd, size, pages);
+
+  // unpin the pages. a page dirtied again while it was being written
+  // stays dirty.
+  for (int s = 0; s < SHARD_COUNT; s++) {
+    Shard& shard = shards[s];
+    Guard guard(shard.lock);
+
+    for (unsigned i = 0; i < pages.size(); i++) {
+      if (pages[i].shard != s) continue;
+      Frame& frame = shard.frames[pages[i].frame];
+      if (rc == 0 && frame.dirty && frame.dirtySeq == pages[i].seq) {
+        frame.dirty = false;
+        shard.dirtyPages.erase(makeKey(fd, pages[i].pid));
+      }
+      frame.pinCount--;
+    }
+  }
+
+  return rc;
+}
+
+RC BufferPool::flushAll()
+{
+  RC rc;
+
+  for (int s = 0; s < SHARD_COUNT; s++) {
+    for (;;) {
+      int fd;
+      {
+        Guard guard(shards[s].lock);
+        if (shards[s].dirtyPages.empty()) break;
+        fd = (int)(*shards[s].dirtyPages.begin() >> 32);
+      }
+      if ((rc = flushFile(fd)) < 0) return rc;
+    }
+  }
+  return 0;
+}
+
+void BufferPool::invalidateFile(int fd)
+{
+  for (int s = 0; s < SHARD_COUNT; s++) {
+    Shard& shard = shards[s];
+    Guard guard(shard.lock);
+
+    for (unsigned f = 0; f < shard.frames.size(); f++) {
+      if (shard.frames[f].fd == fd) release(shard, f);
+    }
+
+    // ghost entries of the file must not promote pages of a later file
+    // that happens to reuse the same descriptor
+    for (list<FrameKey>::iterator it = shard.a1out.begin(); it != shard.a1out.end(); ) {
+      if ((int)(*it >> 32) == fd) {
+        shard.a1outIndex.erase(*it);
+        it = shard.a1out.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+//
+// replacement policy bookkeeping. the shard lock must be held.
+//
+
+void BufferPool::touch(Shard& shard, int f, bool fresh)
+{
+  Frame& frame = shard.frames[f];
+
+  switch (policy) {
+  case CLOCK:
+    frame.referenced = true;
+    break;
+
+  case LRU2:
+    // keep the last two access times. a frame accessed only once has an
+    // infinite backward 2-distance, which is encoded as hist[1] == 0.
+    if (fresh) {
+      frame.hist[0] = frame.hist[1] = 0;
+    } else {
+      shard.lru2Order.erase(make_pair(make_pair(frame.hist[1], frame.hist[0]), f));
+    }
+    frame.hist[1] = frame.hist[0];
+    frame.hist[0] = ++shard.tick;
+    shard.lru2Order.insert(make_pair(make_pair(frame.hist[1], frame.hist[0]), f));
+    break;
+
+  case TWO_Q:
+    if (fresh) {
+      // a page evicted from A1in not long ago is hot: admit it to Am
+      FrameKey key = makeKey(frame.fd, frame.pid);
+      std::unordered_map<FrameKey, list<FrameKey>::iterator>::iterator ghost = shard.a1outIndex.find(key);
+      if (ghost != shard.a1outIndex.end()) {
+        shard.a1out.erase(ghost->second);
+        shard.a1outIndex.erase(ghost);
+        frame.queue = AM;
+        frame.qpos = shard.am.insert(shard.am.begin(), f);
+      } else {
+        frame.queue = A1IN;
+        frame.qpos = shard.a1in.insert(shard.a1in.begin(), f);
+      }
+    } else if (frame.queue == AM) {
+      // hits in A1in are ignored, hits in Am move the frame to the front
+      shard.am.splice(shard.am.begin(), shard.am, frame.qpos);
+    }
+    break;
+  }
+}
+
+void BufferPool::forget(Shard& shard, int f)
+{
+  Frame& frame = shard.frames[f];
+
+  switch (policy) {
+  case CLOCK:
+    frame.referenced = false;
+    break;
+  case LRU2:
+    shard.lru2Order.erase(make_pair(make_pair(frame.hist[1], frame.hist[0]), f));
+    break;
+  case TWO_Q:
+    if (frame.queue == A1IN) shard.a1in.erase(frame.qpos);
+    else shard.am.erase(frame.qpos);
+    break;
+  }
+}
+
+int BufferPool::pickVictim(Shard& shard)
+{
+  int f;
+  vector<Frame>& frames = shard.frames;
+  list<int>::reverse_iterator it;
+
+  switch (policy) {
+  case LRU2:
+    // the frame with the largest backward 2-distance, i.e., the oldest
+    // second-to-last access. ties are broken by the oldest last access.
+    for (std::set<std::pair<std::pair<long, long>, int> >::iterator pos = shard.lru2Order.begin(); pos != shard.lru2Order.end(); ++pos) {
+      if (frames[pos->second].pinCount == 0) return pos->second;
+    }
+    return -1;
+
+  case TWO_Q:
+    // evict from A1in while it holds more than a quarter of the shard and
+    // remember the evicted page in A1out, which is kept at half the shard
+    f = -1;
+    if (shard.a1in.size() > shard.table.size() / 4 || shard.am.empty()) {
+      for (it = shard.a1in.rbegin(); it != shard.a1in.rend(); ++it) {
+        if (frames[*it].pinCount == 0) { f = *it; break; }
+      }
+    }
+    if (f < 0) {
+      for (it = shard.am.rbegin(); it != shard.am.rend(); ++it) {
+        if (frames[*it].pinCount == 0) return *it;
+      }
+      for (it = shard.a1in.rbegin(); it != shard.a1in.rend(); ++it) {
+        if (frames[*it].pinCount == 0) { f = *it; break; }
+      }
+      if (f < 0) return -1;
+    }
+    {
+      FrameKey key = makeKey(frames[f].fd, frames[f].pid);
+      shard.a1outIndex[key] = shard.a1out.insert(shard.a1out.begin(), key);
+      if (shard.a1out.size() > shard.table.size() / 2) {
+        shard.a1outIndex.erase(shard.a1out.back());
+        shard.a1out.pop_back();
+      }
+    }
+    return f;
+
+  case CLOCK:
+  default:
+    // sweep the clock hand, clearing reference bits, until an unpinned
+    // and unreferenced frame is found. two full sweeps without finding
+    // one means that every frame is pinned.
+    for (unsigned n = 0; n < 2 * frames.size(); n++) {
+      f = shard.clockHand;
+      shard.clockHand = (shard.clockHand + 1) % frames.size();
+      if (frames[f].fd < 0 || frames[f].pinCount > 0) continue;
+      if (!frames[f].referenced) return f;
+      frames[f].referenced = false;
+    }
+    return -1;
+  }
+}
@@ -0,0 +1,220 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include <unordered_map>
+#include "Bruinbase.h"
+
+typedef int PageId;
+
+/**
+ * a pool of in-memory page frames shared by all open PageFiles.
+ * frames are found through a hash table keyed by (file, PageId), and
+ * the frame to evict is chosen by a replacement policy selected at runtime.
+ * each file has its own page size, so the pool is sized in bytes and
+ * frames are as large as the pages they hold.
+ *
+ * the pool is safe to use from several threads at once. it is split into
+ * SHARD_COUNT shards, each with its own lock, frame table and replacement
+ * state. runs of SHARD_RUN adjacent pages of a file fall into the same
+ * shard, so that dirty pages can still be written back in large runs.
+ */
+class BufferPool {
+ public:
+
+  // the page replacement policies supported by the pool
+  enum Policy { CLOCK, LRU2, TWO_Q };
+
+  static const int DEFAULT_SIZE_MB = 4;   // pool size when none is given
+  static const int SHARD_COUNT = 16;      // # of independently locked shards
+  static const int SHARD_RUN = 64;        // # of adjacent pages per shard run
+
+  /**
+   * create a pool of DEFAULT_SIZE_MB megabytes.
+   */
+  BufferPool();
+  ~BufferPool();
+
+  /**
+   * resize the pool. dirty pages are written back and
+   * every cached page is dropped.
+   * must not be called while another thread uses the pool.
+   * @param megabytes[IN] the new size of the pool in MB
+   * @return error code. 0 if no error
+   */
+  RC setSize(int megabytes);
+
+  /**
+   * change the replacement policy. dirty pages are written back and
+   * every cached page is dropped.
+   * must not be called while another thread uses the pool.
+   * @param policy[IN] the new replacement policy
+   * @return error code. 0 if no error
+   */
+  RC setPolicy(Policy policy);
+
+  /**
+   * pin the page pid of the file fd in the pool, so that it is not
+   * evicted until it is unpinned. pins are counted.
+   * if the page is not cached, a frame is reserved for it, evicting
+   * another page if the shard is full. when the evicted page is dirty,
+   * the dirty pages of its file in the shard are written back together.
+   * @param fd[IN] the file descriptor of the page
+   * @param pid[IN] the page to pin
+   * @param size[IN] the page size of the file
+   * @param load[IN] read the page from the disk if it is not cached.
+   *                 if false, the caller overwrites the whole frame.
+   * @param frame[OUT] the frame holding the page
+   * @param loaded[OUT] true if the page was read from the disk
+   * @return error code. 0 if no error
+   */
+  RC pin(int fd, PageId pid, int size, bool load, char*& frame, bool& loaded);
+
+  /**
+   * copy the page pid of the file fd to buffer if it is cached.
+   * a page found is counted as a hit. a missing page is not counted.
+   * @param fd[IN] the file descriptor of the page
+   * @param pid[IN] the page to copy
+   * @param buffer[OUT] the buffer to copy the page to
+   * @return true if the page was cached
+   */
+  bool copyCached(int fd, PageId pid, void* buffer);
+
+  /**
+   * read the pages [first, first+count) of the file fd into the pool,
+   * skipping pages that are already cached. each run of adjacent
+   * uncached pages is read with a single preadv call.
+   * @param fd[IN] the file descriptor of the pages
+   * @param first[IN] the first page to read
+   * @param count[IN] # of pages to read
+   * @param size[IN] the page size of the file
+   * @return # of pages read from the disk, or an error code
+   */
+  int prefetch(int fd, PageId first, int count, int size);
+
+  /**
+   * release one pin on the page pid of the file fd.
+   * @param dirty[IN] true if the page was modified. a dirty page is
+   *                  written back when it is evicted or its file is flushed.
+   */
+  void unpin(int fd, PageId pid, bool dirty);
+
+  /**
+   * write back every dirty page of the file fd in PageId order.
+   * runs of adjacent pages are written with a single vectored write,
+   * and the runs are issued together through the AsyncIO engine.
+   * @param fd[IN] the file descriptor to flush
+   * @return error code. 0 if no error
+   */
+  RC flushFile(int fd);
+
+  /**
+   * drop every cached page of the file fd without writing it back.
+   */
+  void invalidateFile(int fd);
+
+  int getHitCount() const      { return hitCount; }
+  int getMissCount() const     { return missCount; }
+  int getEvictionCount() const { return evictionCount; }
+  int getWriteCount() const    { return writeCount; }
+  int getWriteCallCount() const { return writeCallCount; }
+
+  /**
+   * parse a policy name ("clock", "lru2" or "2q").
+   * @param name[IN] the name of the policy
+   * @param policy[OUT] the parsed policy
+   * @return error code. 0 if no error
+   */
+  static RC parsePolicy(const char* name, Policy& policy);
+
+ private:
+  typedef unsigned long long FrameKey;
+
+  struct Frame {
+    int    fd;          // file id of the cached page (-1 if the frame is free)
+    PageId pid;         // page id of the cached page
+    char*  buffer;      // the page content
+    int    size;        // the size of buffer in bytes
+    int    pinCount;    // # of outstanding pins. pinned frames are not evicted
+    bool   dirty;       // true if the page must be written back
+    int    dirtySeq;    // bumped whenever the page is dirtied
+
+    bool   referenced;  // CLOCK: reference bit
+    long   hist[2];     // LRU-2: the last two access times (0 if none)
+    int    queue;       // 2Q: the queue holding this frame (A1IN or AM)
+    std::list<int>::iterator qpos; // 2Q: the position in its queue
+  };
+
+  // a dirty page picked up for write-back
+  struct DirtyPage {
+    PageId pid;
+    char*  buffer;
+    int    shard;
+    int    frame;
+    int    seq;
+    bool operator<(const DirtyPage& other) const { return pid < other.pid; }
+  };
+
+  /**
+   * one independently locked part of the pool
+   */
+  struct Shard {
+    std::mutex lock;
+
+    long   capacity;      // max # of bytes held by the frame buffers
+    long   usedBytes;     // # of bytes held by the frame buffers
+    std::vector<Frame> frames;
+    std::vector<int>   freeFrames;
+    std::unordered_map<FrameKey, int> table;   // (fd, pid) -> frame index
+    std::set<FrameKey> dirtyPages;             // dirty (fd, pid) in flush order
+
+    // CLOCK state
+    int clockHand;
+
+    // LRU-2 state: frames ordered by their backward 2-distance
+    long tick;
+    std::set<std::pair<std::pair<long, long>, int> > lru2Order;
+
+    // 2Q state
+    std::list<int> a1in;                  // frames seen once, FIFO
+    std::list<int> am;                    // frames seen again, LRU
+    std::list<FrameKey> a1out;            // ghost entries evicted from a1in
+    std::unordered_map<FrameKey, std::list<FrameKey>::iterator> a1outIndex;
+  };
+
+  enum { A1IN, AM };
+
+  static FrameKey makeKey(int fd, PageId pid)
+  { return ((FrameKey)(unsigned)fd << 32) | (unsigned)pid; }
+
+  static int shardOf(int fd, PageId pid)
+  { return (unsigned)(fd * 31 + pid / SHARD_RUN) % SHARD_COUNT; }
+
+  void clear();
+  RC   flushAll();
+  RC   writeRuns(int fd, int size, std::vector<DirtyPage>& pages);
+  RC   flushShard(Shard& shard, int fd);
+  int  allocate(Shard& shard, int fd, PageId pid, int size);
+  RC   evict(Shard& shard, int f);
+  void release(Shard& shard, int f);
+  void dropBuffer(Shard& shard, int f);
+  int  pickVictim(Shard& shard);
+  void touch(Shard& shard, int f, bool fresh);
+  void forget(Shard& shard, int f);
+
+  Policy policy;        // the active replacement policy
+  Shard  shards[SHARD_COUNT];
+
+  std::atomic<int> hitCount;
+  std::atomic<int> missCount;
+  std::atomic<int> evictionCount;
+  std::atomic<int> writeCount;       // # of pages written back
+  std::atomic<int> writeCallCount;   // # of pwritev calls used for the write-backs
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,123 @@
+#include "Bruinbase.h"
+#include "ExternalSort.h"
+#include <algorithm>
+
+ExternalSort::ExternalSort(long memory)
+{
+  capacity = memory / sizeof(IndexEntry);
+  if (capacity < 1) capacity = 1;
+  count = 0;
+  finished = false;
+  pos = 0;
+}
+
+ExternalSort::~ExternalSort()
+{
+  for (unsigned i = 0; i < runs.size(); i++) {
+    if (runs[i].file != NULL) fclose(runs[i].file);
+  }
+}
+
+RC ExternalSort::add(int key, const RecordId& rid)
+{
+  RC rc;
+  IndexEntry entry;
+
+  if (finished) return RC_INVALID_ATTRIBUTE;
+
+  entry.key = key;
+  entry.rid = rid;
+  entries.push_back(entry);
+  count++;
+
+  // the memory budget is used up. move the entries to a run file.
+  if ((long)entries.size() >= capacity && (rc = spill()) < 0) return rc;
+  return 0;
+}
+
+RC ExternalSort::spill()
+{
+  Run run;
+
+  std::sort(entries.begin(), entries.end());
+
+  // the run file is deleted automatically when it is closed
+  run.file = tmpfile();
+  if (run.file == NULL) return RC_FILE_OPEN_FAILED;
+  runs.push_back(run);
+
+  if (fwrite(&entries[0], sizeof(IndexEntry), entries.size(), run.file) != entries.size()) {
+    return RC_FILE_WRITE_FAILED;
+  }
+  entries.clear();
+  return 0;
+}
+
+RC ExternalSort::finish()
+{
+  RC rc;
+
+  if (finished) return 0;
+  finished = true;
+
+  // everything fit in memory: the entries are returned straight from there
+  if (runs.empty()) {
+    std::sort(entries.begin(), entries.end());
+    return 0;
+  }
+
+  // otherwise the rest becomes the last run, and the runs are merged
+  if (!entries.empty() && (rc = spill()) < 0) return rc;
+  std::vector<IndexEntry>().swap(entries);
+
+  for (unsigned i = 0; i < runs.size(); i++) {
+    rewind(runs[i].file);
+    if ((rc = refill(i)) < 0) return rc;
+    if (runs[i].pos < runs[i].buffer.size()) {
+      Head head;
+      head.entry = runs[i].buffer[runs[i].pos++];
+      head.run = i;
+      heap.push(head);
+    }
+  }
+  return 0;
+}
+
+RC ExternalSort::refill(int run)
+{
+  Run& r = runs[run];
+
+  r.buffer.resize(RUN_BUFFER);
+  size_t n = fread(&r.buffer[0], sizeof(IndexEntry), RUN_BUFFER, r.file);
+  if (n == 0 && ferror(r.file)) return RC_FILE_READ_FAILED;
+  r.buffer.resize(n);
+  r.pos = 0;
+  return 0;
+}
+
+RC ExternalSort::next(IndexEntry& entry)
+{
+  RC rc;
+
+  if (!finished) return RC_INVALID_ATTRIBUTE;
+
+  if (runs.empty()) {
+    if (pos >= entries.size()) return RC_END_OF_TREE;
+    entry = entries[pos++];
+    return 0;
+  }
+
+  // take the smallest head and replace it with the next entry of its run
+  if (heap.empty()) return RC_END_OF_TREE;
+  Head head = heap.top();
+  heap.pop();
+  entry = head.entry;
+
+  Run& r = runs[head.run];
+  if (r.pos >= r.buffer.size() && (rc = refill(head.run)) < 0) return rc;
+  if (r.pos < r.buffer.size()) {
+    head.entry = r.buffer[r.pos++];
+    heap.push(head);
+  }
+  return 0;
+}
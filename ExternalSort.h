@@ -0,0 +1,97 @@
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include <cstdio>
+#include <queue>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * a (key, RecordId) pair of a B+tree index
+ */
+struct IndexEntry {
+  int      key;
+  RecordId rid;
+
+  // entries are ordered by key, and entries with the same key by rid
+  bool operator<(const IndexEntry& other) const
+  { return key < other.key || (key == other.key && rid < other.rid); }
+};
+
+/**
+ * sort index entries that may not fit in memory.
+ * entries are collected with add(). whenever the memory budget is used up,
+ * the collected entries are sorted and written to a temporary run file.
+ * after finish(), next() returns all entries in sorted order, merging
+ * the runs on the fly.
+ */
+class ExternalSort {
+ public:
+  static const long DEFAULT_MEMORY = 16L << 20;  // memory budget in bytes
+
+  /**
+   * @param memory[IN] # of bytes of entries to keep in memory
+   */
+  ExternalSort(long memory = DEFAULT_MEMORY);
+  ~ExternalSort();
+
+  /**
+   * add an entry to sort.
+   * @param key[IN] the key of the entry
+   * @param rid[IN] the RecordId of the entry
+   * @return error code. 0 if no error
+   */
+  RC add(int key, const RecordId& rid);
+
+  /**
+   * stop collecting entries and prepare to return them in order.
+   * @return error code. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * get the next entry in sorted order.
+   * @param entry[OUT] the next entry
+   * @return error code. RC_END_OF_TREE after the last entry
+   */
+  RC next(IndexEntry& entry);
+
+  /**
+   * @return the total # of entries added
+   */
+  long size() const { return count; }
+
+ private:
+  ExternalSort(const ExternalSort&);
+  ExternalSort& operator=(const ExternalSort&);
+
+  RC spill();
+  RC refill(int run);
+
+  static const int RUN_BUFFER = 4096;  // # of entries read from a run at once
+
+  // a run file being merged
+  struct Run {
+    FILE* file;
+    std::vector<IndexEntry> buffer;
+    unsigned pos;
+  };
+
+  // the head entry of a run, ordered for the merge heap
+  struct Head {
+    IndexEntry entry;
+    int run;
+    bool operator<(const Head& other) const { return other.entry < entry; }
+  };
+
+  long capacity;                      // max # of entries kept in memory
+  long count;                         // # of entries added
+  bool finished;
+  std::vector<IndexEntry> entries;    // entries not yet spilled
+  unsigned pos;                       // next entry when there is no run
+  std::vector<Run> runs;
+  std::priority_queue<Head> heap;
+};
+
+#endif // EXTERNALSORT_H
@@ -0,0 +1,194 @@
+#include "KeySearch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KEYSEARCH_X86
+#include <immintrin.h>
+#endif
+
+//
+// scalar kernels. also used for the keys left over by the vector kernels
+//
+
+static int scalarLess(const int* keys, int n, int key)
+{
+  int count = 0;
+  for (int i = 0; i < n; i++) count += (keys[i] < key);
+  return count;
+}
+
+static int scalarNotGreater(const int* keys, int n, int key)
+{
+  int count = 0;
+  for (int i = 0; i < n; i++) count += (keys[i] <= key);
+  return count;
+}
+
+static int scalarRange(const int* keys, int n, int low, int high, int* sel)
+{
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    // always store, and only move on when the key is selected
+    sel[count] = i;
+    count += (keys[i] >= low) & (keys[i] <= high);
+  }
+  return count;
+}
+
+#ifdef KEYSEARCH_X86
+
+// append the positions of the bits set in mask, counting from base
+static inline int appendBits(unsigned mask, int base, int* sel)
+{
+  int count = 0;
+  while (mask != 0) {
+    sel[count++] = base + __builtin_ctz(mask);
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+//
+// SSE2 kernels: 4 keys per comparison
+//
+
+__attribute__((target("sse2")))
+static int sse2Less(const int* keys, int n, int key)
+{
+  __m128i k = _mm_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+
+  // each lane is all ones where key > the node key
+  for (; i + 4 <= n; i += 4) {
+    __m128i lt = _mm_cmpgt_epi32(k, _mm_loadu_si128((const __m128i*)(keys + i)));
+    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+  }
+  return count + scalarLess(keys + i, n - i, key);
+}
+
+__attribute__((target("sse2")))
+static int sse2NotGreater(const int* keys, int n, int key)
+{
+  __m128i k = _mm_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+
+  // a node key is not greater unless it is greater
+  for (; i + 4 <= n; i += 4) {
+    __m128i gt = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(keys + i)), k);
+    count += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+  }
+  return count + scalarNotGreater(keys + i, n - i, key);
+}
+
+__attribute__((target("sse2")))
+static int sse2Range(const int* keys, int n, int low, int high, int* sel)
+{
+  __m128i lo = _mm_set1_epi32(low);
+  __m128i hi = _mm_set1_epi32(high);
+  int count = 0;
+  int i = 0;
+
+  // each lane is all ones where the key is out of the range
+  for (; i + 4 <= n; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(keys + i));
+    __m128i out = _mm_or_si128(_mm_cmpgt_epi32(lo, k), _mm_cmpgt_epi32(k, hi));
+    unsigned mask = ~_mm_movemask_ps(_mm_castsi128_ps(out)) & 0xF;
+    count += appendBits(mask, i, sel + count);
+  }
+  int rest = scalarRange(keys + i, n - i, low, high, sel + count);
+  for (int j = count; j < count + rest; j++) sel[j] += i;
+  return count + rest;
+}
+
+//
+// AVX2 kernels: 8 keys per comparison
+//
+
+__attribute__((target("avx2")))
+static int avx2Less(const int* keys, int n, int key)
+{
+  __m256i k = _mm256_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i lt = _mm256_cmpgt_epi32(k, _mm256_loadu_si256((const __m256i*)(keys + i)));
+    count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+  }
+  return count + scalarLess(keys + i, n - i, key);
+}
+
+__attribute__((target("avx2")))
+static int avx2NotGreater(const int* keys, int n, int key)
+{
+  __m256i k = _mm256_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i gt = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(keys + i)), k);
+    count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+  }
+  return count + scalarNotGreater(keys + i, n - i, key);
+}
+
+__attribute__((target("avx2")))
+static int avx2Range(const int* keys, int n, int low, int high, int* sel)
+{
+  __m256i lo = _mm256_set1_epi32(low);
+  __m256i hi = _mm256_set1_epi32(high);
+  int count = 0;
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i k = _mm256_loadu_si256((const __m256i*)(keys + i));
+    __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo, k), _mm256_cmpgt_epi32(k, hi));
+    unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xFF;
+    count += appendBits(mask, i, sel + count);
+  }
+  int rest = scalarRange(keys + i, n - i, low, high, sel + count);
+  for (int j = count; j < count + rest; j++) sel[j] += i;
+  return count + rest;
+}
+
+#endif // KEYSEARCH_X86
+
+KeySearch::CountFn KeySearch::lessFn = scalarLess;
+KeySearch::CountFn KeySearch::notGreaterFn = scalarNotGreater;
+KeySearch::RangeFn KeySearch::rangeFn = scalarRange;
+KeySearch::Mode KeySearch::mode = KeySearch::setMode(KeySearch::AVX2);
+
+KeySearch::Mode KeySearch::setMode(Mode m)
+{
+#ifdef KEYSEARCH_X86
+  __builtin_cpu_init();
+  if (m == AVX2 && !__builtin_cpu_supports("avx2")) m = SSE2;
+  if (m == SSE2 && !__builtin_cpu_supports("sse2")) m = SCALAR;
+#else
+  m = SCALAR;
+#endif
+
+  switch (m) {
+#ifdef KEYSEARCH_X86
+  case AVX2:
+    lessFn = avx2Less;
+    notGreaterFn = avx2NotGreater;
+    rangeFn = avx2Range;
+    break;
+  case SSE2:
+    lessFn = sse2Less;
+    notGreaterFn = sse2NotGreater;
+    rangeFn = sse2Range;
+    break;
+#endif
+  default:
+    lessFn = scalarLess;
+    notGreaterFn = scalarNotGreater;
+    rangeFn = scalarRange;
+    break;
+  }
+
+  mode = m;
+  return m;
+}
@@ -0,0 +1,76 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+/**
+ * search kernels for the sorted keys of a B+tree node.
+ * the keys are ints next to each other. the kernels count the keys below
+ * a search key, comparing several keys per instruction with AVX2 or
+ * SSE2 when the CPU supports it, and one at a time otherwise. the
+ * instruction set is picked once, when the program starts.
+ * the same instruction sets filter the keys of a table scan by range.
+ */
+class KeySearch {
+ public:
+  enum Mode { SCALAR, SSE2, AVX2 };
+
+  // # of keys a node search narrows down to with binary search
+  // before the rest is counted with the kernels
+  static const int WINDOW = 64;
+
+  /**
+   * count the keys smaller than key.
+   * @param keys[IN] the keys, next to each other
+   * @param n[IN] # of keys
+   * @param key[IN] the search key
+   * @return # of keys smaller than key
+   */
+  static int countLess(const int* keys, int n, int key)
+  { return lessFn(keys, n, key); }
+
+  /**
+   * count the keys not larger than key.
+   * @param keys[IN] the keys, next to each other
+   * @param n[IN] # of keys
+   * @param key[IN] the search key
+   * @return # of keys smaller than or equal to key
+   */
+  static int countNotGreater(const int* keys, int n, int key)
+  { return notGreaterFn(keys, n, key); }
+
+  /**
+   * find the keys between low and high.
+   * @param keys[IN] the keys, next to each other
+   * @param n[IN] # of keys
+   * @param low[IN] the smallest key to select
+   * @param high[IN] the largest key to select
+   * @param sel[OUT] the positions of the selected keys, in order.
+   *                 room for n positions is needed
+   * @return # of keys selected
+   */
+  static int selectRange(const int* keys, int n, int low, int high, int* sel)
+  { return rangeFn(keys, n, low, high, sel); }
+
+  /**
+   * @return the instruction set the kernels use
+   */
+  static Mode getMode() { return mode; }
+
+  /**
+   * use the given instruction set, or the best one the CPU supports
+   * if it does not support the given one.
+   * @param m[IN] the instruction set to use
+   * @return the instruction set used from now on
+   */
+  static Mode setMode(Mode m);
+
+ private:
+  typedef int (*CountFn)(const int* keys, int n, int key);
+  typedef int (*RangeFn)(const int* keys, int n, int low, int high, int* sel);
+
+  static Mode    mode;
+  static CountFn lessFn;
+  static CountFn notGreaterFn;
+  static RangeFn rangeFn;
+};
+
+#endif // KEYSEARCH_H
@@ -11,26 +11,87 @@
 #include "PageFile.h"
 #include <cstring>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 using std::string;
 
-int PageFile::readCount = 0;
-int PageFile::writeCount = 0;
-int PageFile::cacheClock = 1;
-struct PageFile::cacheStruct PageFile::readCache[PageFile::CACHE_COUNT];
+std::atomic<int> PageFile::readCount(0);
+BufferPool PageFile::bufferPool;
+int PageFile::readAheadPages = PageFile::DEFAULT_READ_AHEAD;
+int PageFile::defaultPageSize = PageFile::DEFAULT_PAGE_SIZE;
+
+// the header page starts with the magic string and the page size
+static const char HEADER_MAGIC[8] = { 'B', 'R', 'U', 'I', 'N', 'P', 'G', 'F' };
+static const int  HEADER_LENGTH = sizeof(HEADER_MAGIC) + sizeof(int);
+
+PinnedPage::PinnedPage()
+{
+  pf = NULL;
+  pid = -1;
+  frame = NULL;
+  dirty = false;
+}
+
+PinnedPage::~PinnedPage()
+{
+  unpin();
+}
+
+RC PinnedPage::unpin()
+{
+  RC rc = 0;
+
+  if (pf != NULL) {
+    rc = pf->unpin(pid, dirty);
+    pf = NULL;
+    pid = -1;
+    frame = NULL;
+    dirty = false;
+  }
+  return rc;
+}
+
+PageRead::PageRead()
+{
+  pf = NULL;
+  pid = -1;
+  buffer = NULL;
+  size = 0;
+  handle = -1;
+}
+
+PageRead::~PageRead()
+{
+  if (pf != NULL) pf->wait(*this);
+  delete [] buffer;
+}
 
 PageFile::PageFile() 
 { 
   fd = -1; 
   epid = 0; 
+  pageSize = LEGACY_PAGE_SIZE;
+  headerPages = 0;
+  map = NULL;
+  touched = NULL;
+  lastPid = -1;
+  seqRun = 0;
+  raEnd = 0;
 }
 
 PageFile::PageFile(const string& filename, char mode)
 {
   fd = -1;
   epid = 0;
+  pageSize = LEGACY_PAGE_SIZE;
+  headerPages = 0;
+  map = NULL;
+  touched = NULL;
+  lastPid = -1;
+  seqRun = 0;
+  raEnd = 0;
   open(filename.c_str(), mode);
 }
 
@@ -38,6 +99,7 @@ RC PageFile::open(const string& filename, char mode)
 {
   RC   rc;
   int  oflag;
+  bool create = false;
   struct stat statbuf;
 
   if (fd > 0) return RC_FILE_OPEN_FAILED;
@@ -51,6 +113,11 @@ RC PageFile::open(const string& filename, char mode)
   case 'w':
   case 'W':
     oflag = (O_RDWR|O_CREAT);
+    create = true;
+    break;
+  case 'm':
+  case 'M':
+    oflag = O_RDONLY;
     break;
   default:
     return RC_INVALID_FILE_MODE;
@@ -63,26 +130,53 @@ RC PageFile::open(const string& filename, char mode)
   // get the size of the file to set the end pid
   rc = ::fstat(fd, &statbuf);
   if (rc < 0) { ::close(fd); fd = -1; return RC_FILE_OPEN_FAILED; }
-  epid = statbuf.st_size / PAGE_SIZE;
+
+  // find the page size of the file
+  if ((rc = readHeader(create, statbuf.st_size)) < 0) { ::close(fd); fd = -1; return rc; }
+  epid = statbuf.st_size / pageSize - headerPages;
+  if (epid < 0) epid = 0;
+  lastPid = -1;
+  seqRun = 0;
+  raEnd = 0;
+
+  // in 'm' mode, map the whole file. an empty file cannot be mapped,
+  // but it has no page to read either.
+  if ((mode == 'm' || mode == 'M') && epid > 0) {
+    void* addr = ::mmap(NULL, offsetOf(epid), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) { ::close(fd); fd = -1; epid = 0; return RC_FILE_OPEN_FAILED; }
+    map = (char*)addr;
+    touched = new std::atomic<unsigned char>[epid]();
+  }
 
   return 0;
 }
 
 RC PageFile::close()
 {
+  RC rc;
+
   if (fd <= 0) return RC_FILE_CLOSE_FAILED;
 
+  // a mapped file is read-only and never goes through the buffer pool
+  if (map != NULL) {
+    ::munmap(map, offsetOf(epid));
+    map = NULL;
+    delete [] touched;
+    touched = NULL;
+    if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
+    fd = -1;
+    epid = 0;
+    return 0;
+  }
+
+  // write back the dirty pages of this file
+  if ((rc = flush()) < 0) return rc;
+
   // close the file
   if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
 
   // evict all cached pages for this file
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-    }
-  }
+  bufferPool.invalidateFile(fd);
 
   // set the fd and epid to the initial state
   fd = -1; 
@@ -90,91 +184,251 @@ RC PageFile::close()
   return 0;
 }
 
-PageId PageFile::endPid() const 
+RC PageFile::readHeader(bool create, off_t size)
 {
-  return epid;
+  char header[HEADER_LENGTH];
+
+  // a new file gets a header page with the default page size
+  if (size == 0 && create) {
+    char* page = new char[defaultPageSize];
+    memset(page, 0, defaultPageSize);
+    memcpy(page, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    memcpy(page + sizeof(HEADER_MAGIC), &defaultPageSize, sizeof(int));
+    ssize_t n = ::pwrite(fd, page, defaultPageSize, 0);
+    delete [] page;
+    if (n != defaultPageSize) return RC_FILE_WRITE_FAILED;
+
+    pageSize = defaultPageSize;
+    headerPages = 1;
+    return 0;
+  }
+
+  // a file without the magic string is an old file of 1KB pages
+  pageSize = LEGACY_PAGE_SIZE;
+  headerPages = 0;
+  if (size < HEADER_LENGTH) return 0;
+  if (::pread(fd, header, HEADER_LENGTH, 0) != HEADER_LENGTH) return RC_FILE_READ_FAILED;
+  if (memcmp(header, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0) return 0;
+
+  int headerSize;
+  memcpy(&headerSize, header + sizeof(HEADER_MAGIC), sizeof(int));
+  if (headerSize < MIN_PAGE_SIZE || headerSize > MAX_PAGE_SIZE || (headerSize & (headerSize - 1)) != 0) {
+    return RC_INVALID_FILE_FORMAT;
+  }
+  pageSize = headerSize;
+  headerPages = 1;
+  return 0;
+}
+
+RC PageFile::setDefaultPageSize(int size)
+{
+  if (size < MIN_PAGE_SIZE || size > MAX_PAGE_SIZE || (size & (size - 1)) != 0) {
+    return RC_INVALID_ATTRIBUTE;
+  }
+  defaultPageSize = size;
+  return 0;
 }
 
-RC PageFile::seek(PageId pid) const
+RC PageFile::flush()
 {
-  return (::lseek(fd, pid * PAGE_SIZE, SEEK_SET) < 0) ? RC_FILE_SEEK_FAILED : 0;
+  if (fd <= 0) return RC_FILE_WRITE_FAILED;
+  if (map != NULL) return 0;
+  return bufferPool.flushFile(fd);
+}
+
+PageId PageFile::endPid() const 
+{
+  return epid;
 }
 
 RC PageFile::write(PageId pid, const void* buffer)
 {
-  RC rc;
+  RC    rc;
+  char* frame;
+  bool  loaded;
+
   if (pid < 0) return RC_INVALID_PID; 
+  if (map != NULL) return RC_INVALID_FILE_MODE;
 
-  // seek to the location of the page
-  if ((rc = seek(pid)) < 0) return rc;
-
-  // write the buffer to the disk page
-  if (::write(fd, buffer, PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
-
-  // if the page is in read cache, invalidate it
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid &&
-        readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-       break;
-    }
+  // the page is written to its buffer pool frame and only marked dirty.
+  // it reaches the disk when it is evicted or the file is flushed.
+  // the pool knows pages by their position in the file, header included.
+  if ((rc = bufferPool.pin(fd, pid + headerPages, pageSize, false, frame, loaded)) < 0) return rc;
+  if (frame != buffer) {
+    memcpy(frame, buffer, pageSize);
   }
+  bufferPool.unpin(fd, pid + headerPages, true);
 
   // if the written pid >= end pid, update the end pid
-  if (pid >= epid) epid = pid + 1;
+  PageId end = epid;
+  while (pid >= end && !epid.compare_exchange_weak(end, pid + 1)) ;
 
-  // increase page write count
-  writeCount++;
+  return 0;
+}
 
+RC PageFile::setReadAhead(int pages)
+{
+  if (pages < 0) return RC_INVALID_ATTRIBUTE;
+  readAheadPages = pages;
   return 0;
 }
 
-RC PageFile::read(PageId pid, void* buffer) const
+RC PageFile::readAsync(PageId pid, PageRead& request) const
 {
   RC rc;
 
-  if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
+  // finish the read the request was used for before
+  if ((rc = wait(request)) < 0) return rc;
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID;
 
-  //
-  // if the page is in cache, read it from there
-  //
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid && 
-        readCache[i].lastAccessed != 0) {
-       memcpy(buffer, readCache[i].buffer, PAGE_SIZE);
-       readCache[i].lastAccessed = ++cacheClock;
-       return 0;
-    }
+  request.pid = pid;
+  if (request.size != pageSize) {
+    delete [] request.buffer;
+    request.buffer = new char[pageSize];
+    request.size = pageSize;
   }
 
-  // seek to the page
-  if ((rc = seek(pid)) < 0) return rc;
-  
-  // find the cache slot to evict
-  int toEvict = 0; 
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].lastAccessed == 0) {
-      toEvict = i;
-      break;
-    }
-    if (readCache[i].lastAccessed < readCache[toEvict].lastAccessed) {
-      toEvict = i;
-    }
+  // a mapped page is copied when it is waited for. until then the
+  // kernel can fault it in while other pages are being processed.
+  if (map != NULL) {
+    ::madvise(map + offsetOf(pid), pageSize, MADV_WILLNEED);
+    request.pf = this;
+    return 0;
   }
-  readCache[toEvict].fd = fd;
-  readCache[toEvict].pid = pid;
-  readCache[toEvict].lastAccessed = ++cacheClock;
- 
-  // read the page to cache first and copy it to the buffer
-  if (::read(fd, readCache[toEvict].buffer, PAGE_SIZE) < 0) {
-    return RC_FILE_READ_FAILED;
+
+  // a cached page needs no I/O
+  if (bufferPool.copyCached(fd, pid + headerPages, request.buffer)) return 0;
+
+  request.handle = AsyncIO::engine().read(fd, request.buffer, pageSize, offsetOf(pid));
+  if (request.handle < 0) { request.handle = -1; return RC_FILE_READ_FAILED; }
+  request.pf = this;
+  return 0;
+}
+
+RC PageFile::wait(PageRead& request) const
+{
+  if (request.pf == NULL) return 0;
+  request.pf = NULL;
+
+  if (map != NULL) {
+    memcpy(request.buffer, map + offsetOf(request.pid), pageSize);
+    if (touched[request.pid].exchange(1) == 0) readCount++;
+    return 0;
   }
-  memcpy(buffer, readCache[toEvict].buffer, PAGE_SIZE);
 
-  // increase the page read count
+  ssize_t n = AsyncIO::engine().wait(request.handle);
+  request.handle = -1;
+  if (n < pageSize) return RC_FILE_READ_FAILED;
   readCount++;
+  return 0;
+}
+
+RC PageFile::prefetch(PageId first, PageId last) const
+{
+  if (fd <= 0) return RC_FILE_READ_FAILED;
+
+  // clip the range to the pages of the file
+  if (first < 0) first = 0;
+  if (last > epid) last = epid;
+  if (first >= last) return 0;
+
+  off_t  offset = offsetOf(first);
+  size_t length = (size_t)(last - first) * pageSize;
+
+  if (map != NULL) {
+    ::madvise(map + offset, length, MADV_WILLNEED);
+  } else {
+    ::posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+  }
+  return 0;
+}
+
+void PageFile::readAhead(PageId pid) const
+{
+  // a page read again does not break a sequential run,
+  // as RecordFile reads every slot of a page in turn
+  PageId prev = lastPid.exchange(pid);
+  if (pid == prev) return;
+  if (pid != prev + 1) { seqRun = 0; return; }
+  if (++seqRun < SEQUENTIAL_RUN || readAheadPages <= 0 || pid < raEnd) return;
+
+  // read the next window of pages at once, including this one
+  PageId last = pid + readAheadPages;
+  if (last > epid) last = epid;
+  raEnd = last;
+
+  if (map != NULL) {
+    prefetch(pid + 1, last);
+  } else {
+    int n = bufferPool.prefetch(fd, pid + headerPages, last - pid, pageSize);
+    if (n > 0) readCount += n;
+  }
+}
+
+RC PageFile::fetch(PageId pid, char*& frame, bool sequential) const
+{
+  RC   rc;
+  bool loaded;
+
+  if (sequential) readAhead(pid);
+
+  // a mapped page is used in place. its first access is counted as
+  // a page read, as it is the one that faults the page in.
+  if (map != NULL) {
+    frame = map + offsetOf(pid);
+    if (touched[pid].exchange(1) == 0) readCount++;
+    return 0;
+  }
+
+  // pin the page in the buffer pool, reading it from the disk
+  // with pread() unless it is already cached
+  if ((rc = bufferPool.pin(fd, pid + headerPages, pageSize, true, frame, loaded)) < 0) return rc;
+
+  // increase the page read count
+  if (loaded) readCount++;
+
+  return 0;
+}
+
+RC PageFile::read(PageId pid, void* buffer) const
+{
+  RC    rc;
+  char* frame;
+
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
+
+  // read the page to cache first and copy it to the buffer
+  if ((rc = fetch(pid, frame, true)) < 0) return rc;
+  memcpy(buffer, frame, pageSize);
+
+  return unpin(pid, false);
+}
+
+RC PageFile::pin(PageId pid, PinnedPage& page, bool sequential) const
+{
+  RC    rc;
+  char* frame;
+
+  page.unpin();
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
+
+  // bring the page into the buffer pool unless it is already there
+  if ((rc = fetch(pid, frame, sequential)) < 0) return rc;
+
+  page.pf = this;
+  page.pid = pid;
+  page.frame = frame;
+  page.dirty = false;
+
+  return 0;
+}
+
+RC PageFile::unpin(PageId pid, bool dirty) const
+{
+  // mapped pages are never pinned in the buffer pool
+  if (map != NULL) return 0;
 
+  // a modified page is written back later like any other dirty page
+  bufferPool.unpin(fd, pid + headerPages, dirty);
   return 0;
 }
@@ -10,36 +10,142 @@
 #ifndef PAGEFILE_H
 #define PAGEFILE_H
 
+#include <atomic>
 #include <string>
 #include "Bruinbase.h"
+#include "AsyncIO.h"
+#include "BufferPool.h"
 
 typedef int PageId;
 
+class PageFile;
+
+/**
+ * a guard over a page pinned in the buffer pool by PageFile::pin().
+ * the guard points straight at the buffered frame, so the page can be
+ * accessed without copying it. the page is unpinned when unpin() is
+ * called or when the guard is destroyed, whichever comes first.
+ */
+class PinnedPage {
+ public:
+  PinnedPage();
+  ~PinnedPage();
+
+  /**
+   * @return pointer to the pinned page content. NULL if nothing is pinned
+   */
+  char* data() const { return frame; }
+
+  /**
+   * @return the id of the pinned page
+   */
+  PageId pageId() const { return pid; }
+
+  /**
+   * mark the pinned page as modified, so that it is written back to
+   * the disk like any page written with PageFile::write().
+   */
+  void markDirty() { dirty = true; }
+
+  /**
+   * release the pin. calling unpin() on a guard holding no pin does nothing.
+   * @return error code. 0 if no error
+   */
+  RC unpin();
+
+ private:
+  friend class PageFile;
+
+  // a pin is owned by exactly one guard
+  PinnedPage(const PinnedPage&);
+  PinnedPage& operator=(const PinnedPage&);
+
+  const PageFile* pf;   // the file the page belongs to (NULL if not pinned)
+  PageId pid;           // the pinned page
+  char*  frame;         // the buffer pool frame holding the page
+  bool   dirty;         // true if the page must be written back on unpin
+};
+
+/**
+ * an asynchronous page read started by PageFile::readAsync().
+ * the page is copied into a buffer owned by the request, which can be
+ * used once PageFile::wait() returns. a request still in flight is
+ * waited for when it is destroyed.
+ */
+class PageRead {
+ public:
+  PageRead();
+  ~PageRead();
+
+  /**
+   * @return pointer to the page content. valid after PageFile::wait()
+   */
+  char* data() const { return buffer; }
+
+  /**
+   * @return the id of the page being read (-1 if none)
+   */
+  PageId pageId() const { return pid; }
+
+ private:
+  friend class PageFile;
+
+  PageRead(const PageRead&);
+  PageRead& operator=(const PageRead&);
+
+  const PageFile* pf;   // the file being read (NULL if no read is pending)
+  PageId pid;           // the page being read
+  char*  buffer;        // the page content
+  int    size;          // the size of buffer in bytes
+  AsyncIO::Handle handle; // the engine request (-1 if there is none)
+};
+
 /**
- * read/write a file in the unit of a page
+ * read/write a file in the unit of a page.
+ * pages are accessed with positional pread/pwrite calls and cached in a
+ * thread-safe buffer pool, so several threads may read the same open
+ * PageFile at once.
+ *
+ * the page size is chosen when a file is created and recorded in a
+ * header page at the start of the file, which is not visible as a page.
+ * a file without the header is an old file of LEGACY_PAGE_SIZE pages.
  */
 class PageFile {
  public:
 
-  static const int PAGE_SIZE = 1024;    // the size of a page is 1KB
+  static const int LEGACY_PAGE_SIZE = 1024;   // page size of files without a header
+  static const int MIN_PAGE_SIZE = 1024;      // smallest page size allowed
+  static const int MAX_PAGE_SIZE = 65536;     // largest page size allowed
+  static const int DEFAULT_PAGE_SIZE = 4096;  // page size of new files by default
 
   PageFile();
   PageFile(const std::string& filename, char mode);
 
   /**
-   * open a file in read or write mode.
-   * when opened in 'w' mode, if the file does not exist, it is created.
+   * open a file in read, write or memory-mapped mode.
+   * when opened in 'w' mode, if the file does not exist, it is created
+   * with the page size set by setDefaultPageSize().
+   * in 'm' mode, the whole file is mapped read-only into memory,
+   * and pages are read from the mapping without going through the buffer
+   * pool. the first access to each page counts as a page read.
    * @param filename[IN] the name of the file to open
-   * @param mode[IN] 'r' for read, 'w' for write
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
    * @return error code. 0 if no error
    */
   RC open(const std::string& filename, char mode);
 
   /**
-   * close the file.
+   * close the file. dirty pages of the file are written back first.
    * @return error code. 0 if no error
    */
   RC close();
+
+  /**
+   * write back every dirty page of the file in PageId order,
+   * combining adjacent pages into a single write.
+   * @return error code. 0 if no error
+   */
+  RC flush();
   
   /**
    * read a disk page into memory buffer.
@@ -48,11 +154,53 @@ class PageFile {
    * @return error code. 0 if no error
    */
   RC read(PageId pid, void *buffer) const;
+
+  /**
+   * pin a disk page in the buffer pool without copying it.
+   * the page stays in the pool, and page.data() points at it,
+   * until page is unpinned. any page previously held by page is unpinned.
+   * @param pid[IN] the page to pin
+   * @param page[OUT] the guard holding the pinned page
+   * @param sequential[IN] false if the page is read out of order, as by
+   *        a lookup. such a read neither starts nor breaks read-ahead
+   * @return error code. 0 if no error
+   */
+  RC pin(PageId pid, PinnedPage& page, bool sequential = true) const;
   
+  /**
+   * start reading the page pid into the buffer of request and return
+   * without waiting for the disk. a cached page is copied at once.
+   * many reads may be in flight together.
+   * @param pid[IN] the page to read
+   * @param request[OUT] the request to wait for with wait()
+   * @return error code. 0 if no error
+   */
+  RC readAsync(PageId pid, PageRead& request) const;
+
+  /**
+   * wait for a read started by readAsync() to complete.
+   * waiting for a completed request again does nothing.
+   * @param request[IN/OUT] the request to wait for
+   * @return error code. 0 if no error
+   */
+  RC wait(PageRead& request) const;
+
+  /**
+   * hint that the pages [first, last) will be read soon. the kernel
+   * starts reading them in the background and the call does not wait.
+   * pages out of the file are ignored.
+   * @param first[IN] the first page to prefetch
+   * @param last[IN] the page after the last page to prefetch
+   * @return error code. 0 if no error
+   */
+  RC prefetch(PageId first, PageId last) const;
+
   /**
    * write the memory buffer to the disk page.
    * if (pid >= endPid()), the file is expanded such that
    * endPid() becomes (pid + 1).
+   * the page is kept dirty in the buffer pool and reaches the disk
+   * when it is evicted or when the file is flushed or closed.
    * @param pid[IN] page to write to
    * @param buffer[IN] the content to write
    * @return error code. 0 if no error
@@ -66,47 +214,138 @@ class PageFile {
    */
   PageId endPid() const;
 
+  /**
+   * @return the size of a page of the file in bytes
+   */
+  int getPageSize() const { return pageSize; }
+
+  /**
+   * set the page size of the files created from now on.
+   * @param size[IN] the page size in bytes. a power of two between
+   *                 MIN_PAGE_SIZE and MAX_PAGE_SIZE
+   * @return error code. 0 if no error
+   */
+  static RC setDefaultPageSize(int size);
+
   /**
    * @return the total # of disk reads
    */
   static int getPageReadCount()  { return readCount; }
   
   /**
-   * @return the total # of disk writes
+   * @return the total # of pages written to the disk
+   */
+  static int getPageWriteCount() { return bufferPool.getWriteCount(); }
+
+  /**
+   * @return the total # of write calls issued to write the pages
+   */
+  static int getWriteCallCount() { return bufferPool.getWriteCallCount(); }
+
+  /**
+   * @return the total # of page requests served from the buffer pool
+   */
+  static int getCacheHitCount()      { return bufferPool.getHitCount(); }
+
+  /**
+   * @return the total # of page requests that missed the buffer pool
+   */
+  static int getCacheMissCount()     { return bufferPool.getMissCount(); }
+
+  /**
+   * @return the total # of pages evicted from the buffer pool
+   */
+  static int getCacheEvictionCount() { return bufferPool.getEvictionCount(); }
+
+  /**
+   * resize the buffer pool shared by all page files.
+   * pages cached so far are dropped.
+   * @param megabytes[IN] the size of the pool in MB
+   * @return error code. 0 if no error
+   */
+  static RC setCacheSize(int megabytes) { return bufferPool.setSize(megabytes); }
+
+  /**
+   * change the page replacement policy of the buffer pool.
+   * pages cached so far are dropped.
+   * @param policy[IN] the replacement policy to use
+   * @return error code. 0 if no error
+   */
+  static RC setCachePolicy(BufferPool::Policy policy) { return bufferPool.setPolicy(policy); }
+
+  /**
+   * set the read-ahead window. when a page file is read sequentially,
+   * the next pages pages are read together into the buffer pool.
+   * @param pages[IN] # of pages to read ahead. 0 disables read-ahead
+   * @return error code. 0 if no error
+   */
+  static RC setReadAhead(int pages);
+
+  static const int DEFAULT_READ_AHEAD = 32; // read-ahead window in pages
+  static const int SEQUENTIAL_RUN = 2;      // # of sequential reads that start read-ahead
+
+ private:
+  friend class PinnedPage;
+
+  /**
+   * bring the page pid into the buffer pool, reading it from the disk
+   * unless it is already cached, and pin it there.
+   * the pin must be released with unpin().
+   * @param pid[IN] the page to fetch
+   * @param frame[OUT] the frame holding the page
+   * @param sequential[IN] false if the read is left out of read-ahead
+   * @return error code. 0 if no error
+   */
+  RC fetch(PageId pid, char*& frame, bool sequential) const;
+
+  /**
+   * release a pin taken by pin(). if dirty is true, the frame is
+   * marked dirty in the buffer pool.
+   * @param pid[IN] the pinned page
+   * @param dirty[IN] whether the page was modified
+   * @return error code. 0 if no error
+   */
+  RC unpin(PageId pid, bool dirty) const;
+
+  /**
+   * @return the file offset of the page pid, skipping the header page
    */
-  static int getPageWriteCount() { return writeCount; }
+  off_t offsetOf(PageId pid) const { return (off_t)(pid + headerPages) * pageSize; }
 
- protected:
   /**
-   * move the file cursor to the beginning of a page.
-   * this is an internal function not exposed to public.
-   * @param pid[IN] page to seek to
+   * read the header page of the open file, or write it if the file is new.
+   * @param create[IN] true if a header may be written to an empty file
+   * @param size[IN] the size of the file in bytes
    * @return error code. 0 if no error
    */
-  RC seek(PageId pid) const;
+  RC readHeader(bool create, off_t size);
+
+  /**
+   * record an access to the page pid and read ahead the pages after it
+   * once the file is being read sequentially.
+   * @param pid[IN] the page being read
+   */
+  void readAhead(PageId pid) const;
 
  private:
   int     fd;     // file descriptor of the associated unix file
-  PageId  epid;   // (last page id + 1) of the file
-
-  //
-  // the following set of members implement LRU caching 
-  //
-  static const int CACHE_COUNT = 10;
-
-  static int cacheClock; // clock tick counter for LRU policy
-
-  // the actual cache data structure
-  static struct cacheStruct {
-    int    fd;              // file id of the cached page
-    PageId pid;             // page id of the cached page
-    int    lastAccessed;    // the last time the cached page was accessed
-                            //   (lastAccessed == 0) means that the buffer is empty
-    char buffer[PAGE_SIZE]; // the buffer used for caching
-  } readCache[CACHE_COUNT];
-
-  static int readCount;  // total # of page reads 
-  static int writeCount; // total # of page writes 
+  int     pageSize;     // the size of a page of the file
+  int     headerPages;  // # of header pages before page 0 (0 or 1)
+  std::atomic<PageId> epid;   // (last page id + 1) of the file
+
+  char*   map;    // the file mapping in 'm' mode (NULL otherwise)
+  std::atomic<unsigned char>* touched; // pages of the mapping accessed so far
+
+  // sequential access detection
+  mutable std::atomic<PageId> lastPid;  // the page read last
+  mutable std::atomic<int>    seqRun;   // # of sequential page reads in a row
+  mutable std::atomic<PageId> raEnd;    // the end of the read-ahead window
+
+  static BufferPool bufferPool; // the page cache shared by all page files
+
+  static std::atomic<int> readCount;  // total # of page reads 
+  static int readAheadPages;          // read-ahead window in pages
+  static int defaultPageSize;         // page size of new files
 };
   
 #endif // PAGEFILE_H
@@ -0,0 +1,351 @@
+#include "ParallelScan.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+using std::mutex;
+using std::unique_lock;
+
+int ParallelScan::threadCount = 0;
+
+/**
+ * the morsels [next, end) a thread has left to process.
+ * other threads may take morsels from the back of the range.
+ */
+struct MorselRange {
+  mutex lock;
+  int   next;
+  int   end;
+};
+
+/**
+ * hands out the morsels of a table file to a set of threads, which run
+ * a task on each of them.
+ */
+class MorselPool {
+ public:
+  MorselPool(const RecordFile& rf, const RecordId& start, int threads,
+             ParallelScan::Task& task);
+
+  /**
+   * start the threads.
+   */
+  void start();
+
+  /**
+   * hand out no more morsels.
+   */
+  void stop();
+
+  /**
+   * wait for the threads to finish.
+   * @return the error code of the first morsel that failed. 0 if none did
+   */
+  RC join();
+
+  /**
+   * @return # of morsels of the records from start to the end of rf
+   */
+  static int countMorsels(const RecordFile& rf, const RecordId& start);
+
+ private:
+  static void work(MorselPool* pool, int t);
+  int  take(int t);
+  void bounds(int m, RecordId& from, RecordId& to) const;
+
+  const RecordFile&   rf;
+  RecordId            first;    // the first record to process
+  int                 morsels;  // # of morsels
+  ParallelScan::Task& task;
+
+  vector<MorselRange> ranges;   // the morsels left, per thread
+  vector<std::thread> threads;
+
+  mutex lock;     // guards stopped and rc
+  bool  stopped;  // true once no more morsels are handed out
+  RC    rc;       // error code of the first morsel that failed
+};
+
+MorselPool::MorselPool(const RecordFile& rf, const RecordId& start, int threads,
+                       ParallelScan::Task& task)
+  : rf(rf), first(start), morsels(countMorsels(rf, start)), task(task),
+    ranges(threads), stopped(false), rc(0)
+{
+  // hand out the morsels in equal runs of consecutive morsels
+  for (int t = 0; t < threads; t++) {
+    ranges[t].next = (long long)morsels * t / threads;
+    ranges[t].end = (long long)morsels * (t + 1) / threads;
+  }
+}
+
+int MorselPool::countMorsels(const RecordFile& rf, const RecordId& start)
+{
+  if (!(start < rf.endRid())) return 0;
+  return rf.endRid().pid / ParallelScan::MORSEL_PAGES + 1;
+}
+
+void MorselPool::start()
+{
+  for (unsigned t = 0; t < ranges.size(); t++) {
+    threads.push_back(std::thread(work, this, t));
+  }
+}
+
+void MorselPool::stop()
+{
+  unique_lock<mutex> guard(lock);
+  stopped = true;
+}
+
+RC MorselPool::join()
+{
+  for (unsigned t = 0; t < threads.size(); t++) threads[t].join();
+  threads.clear();
+  return rc;
+}
+
+/**
+ * compute the records [from, to) of morsel m.
+ */
+void MorselPool::bounds(int m, RecordId& from, RecordId& to) const
+{
+  from.pid = m * ParallelScan::MORSEL_PAGES;
+  from.sid = 0;
+  if (from < first) from = first;
+
+  if (m + 1 == morsels) {
+    to = rf.endRid();
+  } else {
+    to.pid = (m + 1) * ParallelScan::MORSEL_PAGES;
+    to.sid = 0;
+  }
+}
+
+/**
+ * take the next morsel of thread t, stealing from the other threads once
+ * its own range is used up.
+ * @return the morsel taken, or -1 if no morsel is left
+ */
+int MorselPool::take(int t)
+{
+  int n = ranges.size();
+
+  {
+    unique_lock<mutex> guard(lock);
+    if (stopped) return -1;
+  }
+  {
+    unique_lock<mutex> guard(ranges[t].lock);
+    if (ranges[t].next < ranges[t].end) return ranges[t].next++;
+  }
+
+  // steal the back half of the morsels some other thread has left.
+  // only one range lock is held at a time
+  for (int k = 1; k < n; k++) {
+    MorselRange& victim = ranges[(t + k) % n];
+    int from, to;
+    {
+      unique_lock<mutex> guard(victim.lock);
+      int left = victim.end - victim.next;
+      if (left <= 0) continue;
+      from = victim.end - (left + 1) / 2;
+      to = victim.end;
+      victim.end = from;
+    }
+
+    unique_lock<mutex> guard(ranges[t].lock);
+    ranges[t].next = from + 1;
+    ranges[t].end = to;
+    return from;
+  }
+  return -1;
+}
+
+/**
+ * the body of the threads: run the task on morsels until none is left.
+ */
+void MorselPool::work(MorselPool* pool, int t)
+{
+  int m;
+
+  while ((m = pool->take(t)) >= 0) {
+    RecordId from, to;
+    pool->bounds(m, from, to);
+    RC rc = pool->task.run(t, m, from, to);
+    if (rc < 0) {
+      unique_lock<mutex> guard(pool->lock);
+      if (pool->rc == 0) pool->rc = rc;
+      pool->stopped = true;
+    }
+  }
+}
+
+/**
+ * scan the records [from, to) of the file.
+ * the rows are added to sink, or to keys and values if sink is NULL.
+ */
+static RC scanRange(const RecordFile& rf, const RecordId& from, const RecordId& to,
+                    const Predicate& pred, int attr, ResultSink* sink,
+                    vector<int>* keys, vector<char>* values, int& count)
+{
+  RC          rc;
+  RecordBatch batch;
+  RecordId    rid = from;
+  vector<int> sel(ParallelScan::BATCH_RECORDS + rf.recordsPerPage());
+
+  while (rid < to) {
+    if ((rc = rf.readBatch(rid, to, ParallelScan::BATCH_RECORDS, batch)) < 0) return rc;
+    if (batch.size() == 0) break;
+
+    // the keys of a batch are tested together, and only the records
+    // left are tested on their value
+    int n = pred.selectKeys(batch.keys(), batch.size(), &sel[0]);
+    for (int j = 0; j < n; j++) {
+      int i = sel[j];
+      const char* value = batch.value(i);
+      if (!pred.matchValue(batch.keys()[i], value)) continue;
+
+      count++;
+      if (attr == 4) continue;
+      if (sink != NULL) {
+        sink->add(batch.keys()[i], value);
+        continue;
+      }
+      if (attr & 1) keys->push_back(batch.keys()[i]);
+      if (attr & 2) values->insert(values->end(), value, value + strlen(value) + 1);
+    }
+  }
+  return 0;
+}
+
+/**
+ * the task of scan(): the matching rows of every morsel are kept until
+ * the calling thread has emitted the morsels before it.
+ */
+class QueryTask : public ParallelScan::Task {
+ public:
+  struct Result {
+    RC           rc;      // error code of the scan
+    bool         done;    // true once the morsel has been scanned
+    int          count;   // # of tuples that met the predicate
+    vector<int>  keys;    // the keys of the rows, if attr has the key
+    vector<char> values;  // the values of the rows, one after another
+                          // and NUL-terminated, if attr has the value
+  };
+
+  QueryTask(const RecordFile& rf, const Predicate& pred, int attr, int morsels)
+    : rf(rf), pred(pred), attr(attr), results(morsels)
+  {
+    for (int m = 0; m < morsels; m++) {
+      results[m].rc = 0;
+      results[m].done = false;
+      results[m].count = 0;
+    }
+  }
+
+  // a failed morsel is reported to the calling thread, which stops the pool
+  RC run(int /*thread*/, int morsel, const RecordId& from, const RecordId& to)
+  {
+    Result& r = results[morsel];
+    int count = 0;
+    RC rc = scanRange(rf, from, to, pred, attr, NULL, &r.keys, &r.values, count);
+
+    unique_lock<mutex> guard(lock);
+    r.rc = rc;
+    r.count = count;
+    r.done = true;
+    finished.notify_all();
+    return 0;
+  }
+
+  /**
+   * wait until morsel m is done.
+   */
+  Result& wait(int m)
+  {
+    unique_lock<mutex> guard(lock);
+    while (!results[m].done) finished.wait(guard);
+    return results[m];
+  }
+
+ private:
+  const RecordFile& rf;
+  const Predicate&  pred;
+  int               attr;
+  vector<Result>    results;  // the outcome, per morsel
+
+  mutex                   lock;     // guards done, rc and count
+  std::condition_variable finished; // signaled when a morsel is done
+};
+
+int ParallelScan::threadsFor(const RecordFile& rf, const RecordId& start)
+{
+  int threads = threadCount;
+  if (threads <= 0) threads = std::thread::hardware_concurrency();
+  if (threads <= 0) threads = 1;
+  return std::max(1, std::min(threads, MorselPool::countMorsels(rf, start)));
+}
+
+RC ParallelScan::scan(const RecordFile& rf, const RecordId& start,
+                      const Predicate& pred, int attr, ResultSink& sink, int& count)
+{
+  RC  rc = 0;
+  int threads = threadsFor(rf, start);
+  int morsels = MorselPool::countMorsels(rf, start);
+
+  count = 0;
+  if (morsels == 0) return 0;
+
+  // a single thread scans the whole file straight into the sink
+  if (threads == 1) {
+    return scanRange(rf, start, rf.endRid(), pred, attr, &sink, NULL, NULL, count);
+  }
+
+  QueryTask  task(rf, pred, attr, morsels);
+  MorselPool pool(rf, start, threads, task);
+  pool.start();
+
+  // emit the morsels in file order as they complete
+  for (int m = 0; m < morsels; m++) {
+    QueryTask::Result& r = task.wait(m);
+    if (r.rc < 0) {
+      rc = r.rc;
+      pool.stop();
+      break;
+    }
+
+    count += r.count;
+    if (attr != 4) {
+      const char* value = r.values.empty() ? "" : &r.values[0];
+      for (int i = 0; i < r.count; i++) {
+        sink.add((attr & 1) ? r.keys[i] : 0, value);
+        if (attr & 2) value += strlen(value) + 1;
+      }
+    }
+
+    // the rows are not needed any more
+    vector<int>().swap(r.keys);
+    vector<char>().swap(r.values);
+  }
+
+  pool.join();
+  return rc;
+}
+
+RC ParallelScan::run(const RecordFile& rf, const RecordId& start, Task& task)
+{
+  MorselPool pool(rf, start, threadsFor(rf, start), task);
+  pool.start();
+  return pool.join();
+}
+
+RC ParallelScan::setThreadCount(int n)
+{
+  if (n < 1 || n > MAX_THREADS) return RC_INVALID_ATTRIBUTE;
+  threadCount = n;
+  return 0;
+}
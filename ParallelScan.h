@@ -0,0 +1,91 @@
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include "Bruinbase.h"
+#include "RecordFile.h"
+#include "Predicate.h"
+#include "ResultSink.h"
+
+/**
+ * a full scan of a table file by several threads.
+ *
+ * the pages of the file are cut into morsels of MORSEL_PAGES pages, and
+ * every thread starts with an equal share of consecutive morsels. a thread
+ * scans its own morsels from the front, and once it runs out it steals the
+ * back half of the morsels another thread has left.
+ *
+ * scan() answers a query this way. each morsel is read a batch of records
+ * at a time and tested against the predicate, and its count and matching
+ * rows are kept apart from the other morsels. the calling thread hands the
+ * rows to the result sink morsel by morsel, in file order, as soon as the
+ * morsels before them are done, so the output is the same as the one of a
+ * scan by a single thread. run() hands the morsels to any other Task.
+ */
+class ParallelScan {
+ public:
+  static const int MORSEL_PAGES = 64;    // # of pages of a morsel
+  static const int BATCH_RECORDS = 1024; // # of records tested together
+  static const int MAX_THREADS = 64;     // largest # of threads allowed
+
+  /**
+   * the work done on the morsels of a scan. run() is called on several
+   * threads at once, once for every morsel.
+   */
+  class Task {
+   public:
+    virtual ~Task() { }
+
+    /**
+     * process the records [from, to) of the table file.
+     * @param thread[IN] the number of the calling thread, 0 to threads-1
+     * @param morsel[IN] the number of the morsel
+     * @param from[IN] the first record of the morsel
+     * @param to[IN] the record after the morsel
+     * @return error code. 0 if no error. no morsel is started after one
+     *         fails
+     */
+    virtual RC run(int thread, int morsel, const RecordId& from, const RecordId& to) = 0;
+  };
+
+  /**
+   * scan the records of rf from start to the end of the file. the tuples
+   * that meet pred are counted and, unless attr is 4, added to sink.
+   * @param rf[IN] the table file, open for reading
+   * @param start[IN] the first record to scan
+   * @param pred[IN] the conditions of the query
+   * @param attr[IN] the fields of a row, as in SqlEngine::select()
+   * @param sink[IN] the sink the rows are added to
+   * @param count[OUT] # of tuples that meet pred
+   * @return error code. 0 if no error
+   */
+  static RC scan(const RecordFile& rf, const RecordId& start,
+                 const Predicate& pred, int attr, ResultSink& sink, int& count);
+
+  /**
+   * run task on the morsels of rf from start to the end of the file.
+   * @param rf[IN] the table file, open for reading
+   * @param start[IN] the first record to process
+   * @param task[IN] the work to do on each morsel
+   * @return error code. 0 if no error
+   */
+  static RC run(const RecordFile& rf, const RecordId& start, Task& task);
+
+  /**
+   * @param rf[IN] the table file, open for reading
+   * @param start[IN] the first record to process
+   * @return # of threads run() uses for the morsels of rf from start
+   */
+  static int threadsFor(const RecordFile& rf, const RecordId& start);
+
+  /**
+   * set the # of threads of the scans started from now on.
+   * @param n[IN] # of threads. 1 scans on the calling thread alone
+   * @return error code. 0 if no error
+   */
+  static RC setThreadCount(int n);
+
+ private:
+  static int threadCount;  // # of scan threads (0 for one per core)
+};
+
+#endif // PARALLELSCAN_H
@@ -0,0 +1,76 @@
+#include "Planner.h"
+#include <cmath>
+#include <vector>
+
+using std::vector;
+
+// table pages an index scan reads are sorted and read many at a time,
+// so they cost less than isolated random reads would
+const double Planner::RANDOM_PAGE_COST = 2.0;
+const double Planner::ROW_COST = 0.01;
+
+/**
+ * estimate # of distinct pages holding n rows spread over pages pages.
+ */
+static double pagesTouched(double n, double pages)
+{
+  if (pages < 1) return 0;
+  return pages * (1 - pow(1 - 1 / pages, n));
+}
+
+Planner::Plan Planner::choose(const TableStats& stats, const Predicate& pred, int attr, bool hasIndex)
+{
+  Plan plan;
+
+  // the rows of the key ranges are read. a row is taken to meet one term
+  // at most, and the value conditions to be independent of the key
+  vector<Predicate::KeyRange> ranges = pred.keyRanges();
+  double keyRows = 0;
+  for (unsigned r = 0; r < ranges.size(); r++) {
+    keyRows += stats.estimateKeys(ranges[r].low, ranges[r].high);
+  }
+  plan.rows = 0;
+  for (int t = 0; t < pred.termCount(); t++) {
+    const Predicate& term = pred.term(t);
+    double rows = stats.estimateKeys(term.lowKey(), term.highKey());
+    for (int i = 0; i < term.valueCondCount(); i++) {
+      rows *= stats.estimateValues(term.valueComparator(i), term.valueOperand(i));
+    }
+    plan.rows += rows;
+  }
+  if (plan.rows > keyRows) plan.rows = keyRows;
+
+  plan.access = TABLE_SCAN;
+  plan.cost = stats.pages + ROW_COST * stats.rows;
+  if (!hasIndex) return plan;
+
+  // the path from the root to the first key, then the leaves in range.
+  // every further range costs a leaf read out of order, the inner nodes
+  // being cached by then, and no more ranges than leaves are read apart
+  double entries = (stats.leafEntries > 0) ? stats.leafEntries : 1;
+  double descent = RANDOM_PAGE_COST * stats.indexHeight;
+  double leaves = ceil(keyRows / entries);
+  double indexLeaves = ceil(stats.rows / entries);
+  double descents = (ranges.size() < indexLeaves) ? ranges.size() : indexLeaves;
+  if (descents < 1) descents = 1;
+  descent += RANDOM_PAGE_COST * (descents - 1);
+
+  // keys alone come from the leaves, and a count from two paths per range
+  if ((attr == 1 || attr == 4) && !pred.hasValueConds()) {
+    double cost = (attr == 4) ? 2 * RANDOM_PAGE_COST * stats.indexHeight * ranges.size()
+      : descent + leaves + ROW_COST * keyRows;
+    if (cost < plan.cost) {
+      plan.access = INDEX_ONLY;
+      plan.cost = cost;
+    }
+    return plan;
+  }
+
+  double cost = descent + leaves + ROW_COST * keyRows
+    + RANDOM_PAGE_COST * pagesTouched(keyRows, stats.pages);
+  if (cost < plan.cost) {
+    plan.access = INDEX_SCAN;
+    plan.cost = cost;
+  }
+  return plan;
+}
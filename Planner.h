@@ -0,0 +1,49 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "Bruinbase.h"
+#include "Predicate.h"
+#include "TableStats.h"
+
+/**
+ * chooses how a SELECT reads its table.
+ *
+ * the rows the key conditions let through are estimated from the
+ * statistics of the table, and every way of answering the query is
+ * given a cost in units of one page read in file order:
+ *   TABLE_SCAN: every page of the table is read in order, and every row
+ *               is tested
+ *   INDEX_SCAN: the index is searched for the first key, its leaves are
+ *               read up to the last key, and the table pages holding the
+ *               rows found are read out of order. with OR or IN, the
+ *               leaves between key ranges are skipped
+ *   INDEX_ONLY: as INDEX_SCAN without reading the table. possible when
+ *               the query needs nothing but keys. a COUNT(*) reads only
+ *               the paths to the two ends of every key range
+ * the plan with the smallest cost is chosen.
+ */
+class Planner {
+ public:
+  enum Access { TABLE_SCAN, INDEX_SCAN, INDEX_ONLY };
+
+  struct Plan {
+    Access access;  // how the table is read
+    double rows;    // estimated # of rows meeting all the conditions
+    double cost;    // estimated cost of the plan
+  };
+
+  static const double RANDOM_PAGE_COST;  // a page read out of order
+  static const double ROW_COST;          // testing or producing a row
+
+  /**
+   * choose the cheapest plan for a query.
+   * @param stats[IN] the statistics of the table
+   * @param pred[IN] the conditions of the query
+   * @param attr[IN] the fields of a row, as in SqlEngine::select()
+   * @param hasIndex[IN] true if the table has an index
+   * @return the plan
+   */
+  static Plan choose(const TableStats& stats, const Predicate& pred, int attr, bool hasIndex);
+};
+
+#endif // PLANNER_H
@@ -0,0 +1,203 @@
+#include "Predicate.h"
+#include "KeySearch.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+using std::vector;
+using std::max;
+using std::min;
+using std::sort;
+using std::unique;
+using std::lower_bound;
+using std::upper_bound;
+
+/**
+ * orders key ranges by their low ends.
+ */
+struct RangeOrder {
+  bool operator()(const Predicate::KeyRange& a, const Predicate::KeyRange& b) const
+  { return a.low < b.low; }
+};
+
+//
+// comparison functions, one per comparator. the tables below are in the
+// order of SelCond::Comparator
+//
+
+static bool keyEQ(int key, int v) { return key == v; }
+static bool keyNE(int key, int v) { return key != v; }
+static bool keyLT(int key, int v) { return key < v; }
+static bool keyGT(int key, int v) { return key > v; }
+static bool keyLE(int key, int v) { return key <= v; }
+static bool keyGE(int key, int v) { return key >= v; }
+
+static bool valueEQ(const char* value, const char* v) { return strcmp(value, v) == 0; }
+static bool valueNE(const char* value, const char* v) { return strcmp(value, v) != 0; }
+static bool valueLT(const char* value, const char* v) { return strcmp(value, v) < 0; }
+static bool valueGT(const char* value, const char* v) { return strcmp(value, v) > 0; }
+static bool valueLE(const char* value, const char* v) { return strcmp(value, v) <= 0; }
+static bool valueGE(const char* value, const char* v) { return strcmp(value, v) >= 0; }
+
+static bool (* const keyTests[])(int, int) =
+  { keyEQ, keyNE, keyLT, keyGT, keyLE, keyGE };
+
+static bool (* const valueTests[])(const char*, const char*) =
+  { valueEQ, valueNE, valueLT, valueGT, valueLE, valueGE };
+
+Predicate::Predicate(const vector<SelCond>& cond)
+{
+  compile(cond);
+}
+
+Predicate::Predicate(const vector<vector<SelCond> >& disjuncts)
+{
+  vector<unsigned> kept;
+
+  // the terms that no key can meet are left out
+  low = INT_MAX + 1LL;
+  high = INT_MIN - 1LL;
+  for (unsigned t = 0; t < disjuncts.size(); t++) {
+    Predicate term(disjuncts[t]);
+    if (term.isEmpty()) continue;
+    low = min(low, term.low);
+    high = max(high, term.high);
+    terms.push_back(term);
+    kept.push_back(t);
+  }
+
+  // with a single term left, or none, a conjunction is tested
+  if (terms.size() <= 1) {
+    unsigned t = kept.empty() ? 0 : kept[0];
+    terms.clear();
+    compile(t < disjuncts.size() ? disjuncts[t] : vector<SelCond>());
+    return;
+  }
+
+  // a key one term excludes may still be let through by another
+  for (unsigned t = 0; t < terms.size(); t++) {
+    for (unsigned i = 0; i < terms[t].excluded.size(); i++) {
+      if (!matchKey(terms[t].excluded[i])) excluded.push_back(terms[t].excluded[i]);
+    }
+  }
+  sort(excluded.begin(), excluded.end());
+  excluded.erase(unique(excluded.begin(), excluded.end()), excluded.end());
+}
+
+void Predicate::compile(const vector<SelCond>& cond)
+{
+  low = INT_MIN;
+  high = INT_MAX;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1) {
+      KeyCond c;
+      c.test = keyTests[cond[i].comp];
+      c.operand = atoi(cond[i].value);
+      keyConds.push_back(c);
+
+      long long v = c.operand;
+      switch (cond[i].comp) {
+      case SelCond::EQ: low = max(low, v); high = min(high, v); break;
+      case SelCond::NE: excluded.push_back(c.operand); break;
+      case SelCond::LT: high = min(high, v - 1); break;
+      case SelCond::GT: low = max(low, v + 1); break;
+      case SelCond::LE: high = min(high, v); break;
+      case SelCond::GE: low = max(low, v); break;
+      }
+    } else {
+      ValueCond c;
+      c.test = valueTests[cond[i].comp];
+      c.comp = cond[i].comp;
+      c.operand = cond[i].value;
+      valueConds.push_back(c);
+    }
+  }
+
+  // the excluded keys at the ends of the range move the ends inwards,
+  // and those outside the range exclude nothing more
+  if (low > high) {
+    excluded.clear();
+    return;
+  }
+  sort(excluded.begin(), excluded.end());
+  excluded.erase(unique(excluded.begin(), excluded.end()), excluded.end());
+  vector<int>::iterator first = lower_bound(excluded.begin(), excluded.end(), low);
+  vector<int>::iterator last = upper_bound(excluded.begin(), excluded.end(), high);
+  while (first != last && *first == low) { low++; ++first; }
+  while (first != last && *(last - 1) == high) { high--; --last; }
+  excluded = vector<int>(first, last);
+}
+
+int Predicate::selectKeys(const int* keys, int n, int* sel) const
+{
+  int count;
+
+  if (low > high) return 0;
+  if (!terms.empty()) {
+    count = 0;
+    for (int i = 0; i < n; i++) {
+      if (matchKey(keys[i])) sel[count++] = i;
+    }
+    return count;
+  }
+  if (keyConds.empty()) {
+    for (int i = 0; i < n; i++) sel[i] = i;
+    return n;
+  }
+
+  count = KeySearch::selectRange(keys, n, (int)low, (int)high, sel);
+
+  // the keys excluded by NE are dropped from the selection
+  if (!excluded.empty()) {
+    int kept = 0;
+    for (int j = 0; j < count; j++) {
+      if (std::find(excluded.begin(), excluded.end(), keys[sel[j]]) == excluded.end()) {
+        sel[kept++] = sel[j];
+      }
+    }
+    count = kept;
+  }
+  return count;
+}
+
+bool Predicate::hasValueConds() const
+{
+  for (unsigned t = 0; t < terms.size(); t++) {
+    if (terms[t].hasValueConds()) return true;
+  }
+  return !valueConds.empty();
+}
+
+vector<Predicate::KeyRange> Predicate::keyRanges() const
+{
+  vector<KeyRange> ranges;
+
+  if (terms.empty()) {
+    if (low <= high) {
+      KeyRange r = { low, high };
+      ranges.push_back(r);
+    }
+    return ranges;
+  }
+
+  // the ranges of the terms in order of their low ends, with the ones
+  // that overlap or touch merged
+  for (unsigned t = 0; t < terms.size(); t++) {
+    KeyRange r = { terms[t].low, terms[t].high };
+    ranges.push_back(r);
+  }
+  sort(ranges.begin(), ranges.end(), RangeOrder());
+
+  unsigned merged = 0;
+  for (unsigned i = 1; i < ranges.size(); i++) {
+    if (ranges[i].low <= ranges[merged].high + 1) {
+      ranges[merged].high = max(ranges[merged].high, ranges[i].high);
+    } else {
+      ranges[++merged] = ranges[i];
+    }
+  }
+  ranges.resize(merged + 1);
+  return ranges;
+}
@@ -0,0 +1,195 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <vector>
+#include "SqlEngine.h"
+
+/**
+ * the conditions of a WHERE clause, compiled once per query.
+ * the constant of every key condition is parsed up front, and each
+ * condition is bound to the comparison function of its comparator, so
+ * testing a tuple does no parsing and no dispatch on the comparator.
+ * key conditions are kept apart from value conditions, so that a tuple
+ * can be rejected on its key before its value is read.
+ *
+ * a WHERE clause with OR is a disjunction of terms, each of which is a
+ * conjunction of conditions compiled as above. a tuple meets it if it
+ * meets every condition of at least one term.
+ */
+class Predicate {
+ public:
+  /**
+   * a range [low, high] of keys.
+   */
+  struct KeyRange {
+    long long low;
+    long long high;
+  };
+
+  /**
+   * compile a conjunction of conditions.
+   * @param cond[IN] the conditions. the value strings must stay alive
+   *                 as long as the predicate
+   */
+  Predicate(const std::vector<SelCond>& cond);
+
+  /**
+   * compile a disjunction of conjunctions.
+   * @param terms[IN] the terms, each a list of conditions ANDed together.
+   *                  the value strings must stay alive as long as the
+   *                  predicate
+   */
+  Predicate(const std::vector<std::vector<SelCond> >& terms);
+
+  /**
+   * @param key[IN] the key of a tuple
+   * @return true if the key meets every condition on the key of some term
+   */
+  bool matchKey(int key) const
+  {
+    if (!terms.empty()) {
+      for (unsigned t = 0; t < terms.size(); t++) {
+        if (terms[t].matchKey(key)) return true;
+      }
+      return false;
+    }
+    for (unsigned i = 0; i < keyConds.size(); i++) {
+      if (!keyConds[i].test(key, keyConds[i].operand)) return false;
+    }
+    return true;
+  }
+
+  /**
+   * test a tuple whose key passed matchKey() or selectKeys().
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return true if the tuple meets every condition of some term
+   */
+  bool matchValue(int key, const char* value) const
+  {
+    if (!terms.empty()) {
+      for (unsigned t = 0; t < terms.size(); t++) {
+        if (terms[t].match(key, value)) return true;
+      }
+      return false;
+    }
+    for (unsigned i = 0; i < valueConds.size(); i++) {
+      if (!valueConds[i].test(value, valueConds[i].operand)) return false;
+    }
+    return true;
+  }
+
+  /**
+   * @param key[IN] the key of a tuple
+   * @param value[IN] the value of a tuple
+   * @return true if the tuple meets every condition of some term
+   */
+  bool match(int key, const char* value) const
+  { return matchKey(key) && matchValue(key, value); }
+
+  /**
+   * find the keys that meet every condition on the key of some term. the
+   * conditions of a conjunction other than NE are applied together as
+   * one range, several keys per instruction.
+   * @param keys[IN] the keys, next to each other
+   * @param n[IN] # of keys
+   * @param sel[OUT] the positions of the keys that meet the conditions,
+   *                 in order. room for n positions is needed
+   * @return # of keys selected
+   */
+  int selectKeys(const int* keys, int n, int* sel) const;
+
+  /**
+   * @return true if some term has a condition on the value
+   */
+  bool hasValueConds() const;
+
+  /**
+   * @return # of terms of the disjunction, 1 for a conjunction
+   */
+  int termCount() const { return terms.empty() ? 1 : terms.size(); }
+
+  /**
+   * @param t[IN] the number of a term
+   * @return the term, compiled as a conjunction
+   */
+  const Predicate& term(int t) const { return terms.empty() ? *this : terms[t]; }
+
+  /**
+   * @return # of conditions on the value of a conjunction
+   */
+  int valueCondCount() const { return valueConds.size(); }
+
+  /**
+   * @param i[IN] the number of a condition on the value of a conjunction
+   * @return the comparator of the condition
+   */
+  SelCond::Comparator valueComparator(int i) const { return valueConds[i].comp; }
+
+  /**
+   * @param i[IN] the number of a condition on the value of a conjunction
+   * @return the constant the value is compared with
+   */
+  const char* valueOperand(int i) const { return valueConds[i].operand; }
+
+  /**
+   * @return the smallest key that can meet the key conditions
+   */
+  long long lowKey() const { return low; }
+
+  /**
+   * @return the largest key that can meet the key conditions. no key
+   *         can meet them if it is smaller than lowKey()
+   */
+  long long highKey() const { return high; }
+
+  /**
+   * @return true if no key can meet the key conditions
+   */
+  bool isEmpty() const { return low > high; }
+
+  /**
+   * @return the keys inside keyRanges() that the key conditions
+   *         exclude, in increasing order
+   */
+  const std::vector<int>& excludedKeys() const { return excluded; }
+
+  /**
+   * @return the ranges of keys that can meet the key conditions, sorted
+   *         and apart from each other. a conjunction has one range
+   */
+  std::vector<KeyRange> keyRanges() const;
+
+ private:
+  typedef bool (*KeyTest)(int key, int operand);
+  typedef bool (*ValueTest)(const char* value, const char* operand);
+
+  struct KeyCond {
+    KeyTest test;
+    int     operand;
+  };
+
+  struct ValueCond {
+    ValueTest           test;
+    SelCond::Comparator comp;
+    const char*         operand;
+  };
+
+  void compile(const std::vector<SelCond>& cond);
+
+  std::vector<KeyCond>   keyConds;    // conditions on the key
+  std::vector<ValueCond> valueConds;  // conditions on the value
+
+  // the key conditions folded into the range [low, high] and the keys
+  // inside it excluded by NE. the range is empty if low > high.
+  // for a disjunction, the smallest range holding the ranges of all
+  // terms, and the keys inside them that no term lets through
+  long long        low;
+  long long        high;
+  std::vector<int> excluded;
+
+  std::vector<Predicate> terms;  // the terms of a disjunction, empty
+                                 // for a conjunction
+};
+
+#endif // PREDICATE_H
@@ -10,8 +10,10 @@
 #include "Bruinbase.h"
 #include "RecordFile.h"
 #include <cstring>
+#include <vector>
 
 using std::string;
+using std::vector;
 
 //
 // helper functions for page manipultation
@@ -37,32 +39,6 @@ static void setRecordCount(char* page, int count);
 // helper functions for RecordId manipulation
 //
 
-// postfix record id iterator
-RecordId operator++ (RecordId& rid, int)
-{
-  RecordId prid(rid);
-
-  // if the end of a page is reached, move to the next page
-  if (++rid.sid >= RecordFile::RECORDS_PER_PAGE) {
-    rid.pid++;
-    rid.sid = 0;
-  }
-
-  return prid;
-}
-
-// prefix record id iterator
-RecordId& operator++ (RecordId& rid)
-{
-  // if the end of a page is reached, move to the next page
-  if (++rid.sid >= RecordFile::RECORDS_PER_PAGE) {
-    rid.pid++;
-    rid.sid = 0;
-  } 
-
-  return rid;
-}
-
 // RecordId comparators
 bool operator < (const RecordId& r1, const RecordId& r2)
 {
@@ -117,7 +93,7 @@ RecordFile::RecordFile(const string& filename, char mode)
 RC RecordFile::open(const string& filename, char mode)
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
+  PinnedPage page;
 
   // open the page file
   if ((rc = pf.open(filename, mode)) < 0) return rc;
@@ -139,7 +115,7 @@ RC RecordFile::open(const string& filename, char mode)
   // obtain # records in the last page to set sid of the end record id.
   // read the last page of the file and get # records in the page.
   // remeber that the id of the last page is endPid()-1 not endPid().
-  if ((rc = pf.read(--erid.pid, page)) < 0) {
+  if ((rc = pf.pin(--erid.pid, page)) < 0) {
     // an error occurred during page read
     erid.pid = erid.sid = 0;
     pf.close();
@@ -147,8 +123,9 @@ RC RecordFile::open(const string& filename, char mode)
   }
 
   // get # records in the last page
-  erid.sid = getRecordCount(page);
-  if (erid.sid >= RECORDS_PER_PAGE) {
+  erid.sid = getRecordCount(page.data());
+  page.unpin();
+  if (erid.sid >= recordsPerPage()) {
     // the last page is full. advance the end record id to the next page.
     erid.pid++;
     erid.sid = 0;
@@ -168,18 +145,86 @@ RC RecordFile::close()
 RC RecordFile::read(const RecordId& rid, int& key, string& value) const
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
+  PinnedPage page;
   
   // check whether the rid is in the valid range
   if (rid.pid < 0 || rid.pid > erid.pid) return RC_INVALID_RID;
-  if (rid.sid < 0 || rid.sid >= RecordFile::RECORDS_PER_PAGE) return RC_INVALID_RID;
+  if (rid.sid < 0 || rid.sid >= recordsPerPage()) return RC_INVALID_RID;
   if (rid >= erid) return RC_INVALID_RID;
   
-  // read the page containing the record
-  if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+  // pin the page containing the record. the record is read straight
+  // from the buffer pool without copying the page.
+  if ((rc = pf.pin(rid.pid, page)) < 0) return rc;
 
   // read the record from the slot in the page
-  readSlot(page, rid.sid, key, value);
+  readSlot(page.data(), rid.sid, key, value);
+
+  return 0;
+}
+
+RC RecordFile::readBatch(RecordId& rid, const RecordId& end, int max, RecordBatch& batch) const
+{
+  RC  rc;
+  int perPage = recordsPerPage();
+  int pageSize = pf.getPageSize();
+  RecordId stop = (end < erid) ? end : erid;
+
+  batch.count = 0;
+  batch.first = rid;
+  batch.perPage = perPage;
+  if (rid.pid < 0 || rid.sid < 0 || rid.sid >= perPage) return RC_INVALID_RID;
+
+  // room for every page the batch may take
+  int pages = max / perPage + 1;
+  if ((int)batch.data.size() < pages * pageSize) batch.data.resize(pages * pageSize);
+  if ((int)batch.keyv.size() < max + perPage) {
+    batch.keyv.resize(max + perPage);
+    batch.offsets.resize(max + perPage);
+  }
+
+  for (int p = 0; rid < stop; p++) {
+    // stop before the page would overflow the batch
+    int last = (rid.pid == stop.pid) ? stop.sid : perPage;
+    if (p > 0 && batch.count + last - rid.sid > max) break;
+
+    char* page = &batch.data[p * pageSize];
+    if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+
+    // the key and the value of every record, the value left in place
+    for (int sid = rid.sid; sid < last; sid++) {
+      char* ptr = slotPtr(page, sid);
+      memcpy(&batch.keyv[batch.count], ptr, sizeof(int));
+      batch.offsets[batch.count] = ptr + sizeof(int) - &batch.data[0];
+      batch.count++;
+    }
+
+    rid.sid = last;
+    if (rid.sid >= perPage) {
+      rid.pid++;
+      rid.sid = 0;
+    }
+  }
+
+  return 0;
+}
+
+RC RecordFile::readAsync(const RecordId& rid, PageRead& request) const
+{
+  if (rid.pid < 0 || rid.pid > erid.pid) return RC_INVALID_RID;
+  return pf.readAsync(rid.pid, request);
+}
+
+RC RecordFile::read(PageRead& request, const RecordId& rid, int& key, string& value) const
+{
+  RC rc;
+
+  // check whether the rid is in the valid range and on the requested page
+  if (rid.pid != request.pageId()) return RC_INVALID_RID;
+  if (rid.sid < 0 || rid.sid >= recordsPerPage()) return RC_INVALID_RID;
+  if (rid >= erid) return RC_INVALID_RID;
+
+  if ((rc = pf.wait(request)) < 0) return rc;
+  readSlot(request.data(), rid.sid, key, value);
 
   return 0;
 }
@@ -187,37 +232,51 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
 RC RecordFile::append(int key, const std::string& value, RecordId& rid)
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
 
   // unless we are writing to the the first slot of an empty page,
-  // we have to read the page first
+  // we update the last page in place in the buffer pool
   if (erid.sid > 0) {
-    if ((rc = pf.read(erid.pid, page)) < 0) return rc;
+    PinnedPage page;
+    if ((rc = pf.pin(erid.pid, page)) < 0) return rc;
+
+    // write the record to the first empty slot and
+    // update # records stored in the page
+    writeSlot(page.data(), erid.sid, key, value);
+    setRecordCount(page.data(), erid.sid + 1);
+    page.markDirty();
   } else {
     // if this is the first slot of an empty page
     // we can simply initialize the page with zeros
-    memset(page, 0, PageFile::PAGE_SIZE);
-  }
-    
-  // write the record to the first empty slot 
-  writeSlot(page, erid.sid, key, value);
+    vector<char> buffer(pf.getPageSize(), 0);
+    writeSlot(&buffer[0], erid.sid, key, value);
 
-  // the first four bytes in the page stores # records in the page.
-  // update this number.
-  setRecordCount(page, erid.sid + 1);
+    // the first four bytes in the page stores # records in the page.
+    setRecordCount(&buffer[0], erid.sid + 1);
 
-  // write the page to the disk
-  if ((rc = pf.write(erid.pid, page)) < 0) return rc;
+    // write the page to the disk
+    if ((rc = pf.write(erid.pid, &buffer[0])) < 0) return rc;
+  }
     
   // we need to output the rid of the record slot
   rid = erid;
 
   // advance the end record id by one to the next empty slot
-  ++erid;
+  next(erid);
 
   return 0;
 }
 
+RecordId& RecordFile::next(RecordId& rid) const
+{
+  // if the end of a page is reached, move to the next page
+  if (++rid.sid >= recordsPerPage()) {
+    rid.pid++;
+    rid.sid = 0;
+  }
+
+  return rid;
+}
+
 const RecordId& RecordFile::endRid() const
 {
   return erid;
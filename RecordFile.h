@@ -11,6 +11,7 @@
 #define RECORDFILE_H
 
 #include <string>
+#include <vector>
 #include "PageFile.h"
 
 /**
@@ -26,10 +27,6 @@ typedef struct {
 // helper functions for RecordId
 // 
 
-// RecordId iterators
-RecordId& operator++ (RecordId& rid);
-RecordId  operator++ (RecordId& rid, int);
-
 // RecordId comparators
 bool operator> (const RecordId& r1, const RecordId& r2);
 bool operator< (const RecordId& r1, const RecordId& r2);
@@ -38,6 +35,55 @@ bool operator<= (const RecordId& r1, const RecordId& r2);
 bool operator== (const RecordId& r1, const RecordId& r2);
 bool operator!= (const RecordId& r1, const RecordId& r2);
 
+/**
+ * the records of a run of pages, decoded by RecordFile::readBatch() into
+ * an array of keys and the offsets of the values. the values stay in a
+ * copy of the pages held by the batch, so they are read without
+ * copying each one out.
+ */
+class RecordBatch {
+ public:
+  RecordBatch() : count(0), perPage(1) { first.pid = first.sid = 0; }
+
+  /**
+   * @return # of records in the batch
+   */
+  int size() const { return count; }
+
+  /**
+   * @return the keys of the records, in record order
+   */
+  const int* keys() const { return &keyv[0]; }
+
+  /**
+   * @param i[IN] the record number in the batch
+   * @return the value of the i'th record
+   */
+  const char* value(int i) const { return &data[offsets[i]]; }
+
+  /**
+   * @param i[IN] the record number in the batch
+   * @return the id of the i'th record
+   */
+  RecordId rid(int i) const
+  {
+    RecordId r;
+    r.pid = first.pid + (first.sid + i) / perPage;
+    r.sid = (first.sid + i) % perPage;
+    return r;
+  }
+
+ private:
+  friend class RecordFile;
+
+  int      count;    // # of records
+  RecordId first;    // the id of the first record
+  int      perPage;  // # of record slots per page
+  std::vector<int>  keyv;     // the keys
+  std::vector<int>  offsets;  // where each value starts in data
+  std::vector<char> data;     // the pages the records came from
+};
+
 /**
  * read/write a record to a file
  */
@@ -47,10 +93,8 @@ class RecordFile {
   // maximum length of the value field
   static const int MAX_VALUE_LENGTH = 100;  
 
-  // number of record slots per page
-  static const int RECORDS_PER_PAGE = (PageFile::PAGE_SIZE - sizeof(int))/ (sizeof(int) + MAX_VALUE_LENGTH);  
-    // Note that we subtract sizeof(int) from PAGE_SIZE because the first
-    // four bytes in the page is used to store # records in the page.
+  // size of a record slot in a page
+  static const int SLOT_SIZE = sizeof(int) + MAX_VALUE_LENGTH;
 
   RecordFile();
   RecordFile(const std::string& filename, char mode);
@@ -59,7 +103,7 @@ class RecordFile {
    * open a file in read or write mode.
    * when opened in 'w' mode, if the file does not exist, it is created.
    * @param filename[IN] the name of the file to open
-   * @param mode[IN] 'r' for read, 'w' for write
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
    * @return error code. 0 if no error
    */
   RC open(const std::string& filename, char mode);
@@ -79,6 +123,40 @@ class RecordFile {
    */
   RC read(const RecordId& rid, int& key, std::string& value) const;
 
+  /**
+   * read the records from rid on into batch, a page at a time, and move
+   * rid behind them. whole pages are decoded as long as the batch has
+   * room for them, and at least one page is. the batch is empty once rid
+   * reaches end or endRid().
+   * @param rid[IN/OUT] the first record to read. moved to the record after
+   *                    the batch
+   * @param end[IN] the record to stop at
+   * @param max[IN] # of records the batch has room for
+   * @param batch[OUT] the records read
+   * @return error code. 0 if no error
+   */
+  RC readBatch(RecordId& rid, const RecordId& end, int max, RecordBatch& batch) const;
+
+  /**
+   * start reading the page holding the record rid in the background.
+   * the record is then read with read(request, rid, key, value).
+   * @param rid[IN] the id of the record to read later
+   * @param request[OUT] the pending page read
+   * @return error code. 0 if no error
+   */
+  RC readAsync(const RecordId& rid, PageRead& request) const;
+
+  /**
+   * read a record from a page requested with readAsync(), waiting for
+   * the page if it has not arrived yet.
+   * @param request[IN/OUT] the page read holding the record
+   * @param rid[IN] the id of the record to read
+   * @param key[OUT] the record key
+   * @param value[OUT] the record value
+   * @return error code. 0 if no error
+   */
+  RC read(PageRead& request, const RecordId& rid, int& key, std::string& value) const;
+
   /**
    * append a new record at the end of the file.
    * note that RecordFile does not have write() function.
@@ -90,6 +168,23 @@ class RecordFile {
    */
   RC append(int key, const std::string& value, RecordId& rid);
 
+  /**
+   * the number of record slots per page depends on the page size of
+   * the file. note that we subtract sizeof(int) from the page size
+   * because the first four bytes in the page is used to store # records
+   * in the page.
+   * @return # of record slots per page
+   */
+  int recordsPerPage() const { return (pf.getPageSize() - sizeof(int)) / SLOT_SIZE; }
+
+  /**
+   * move rid to the next record slot of the file. when the end of a page
+   * is reached, rid moves to the first slot of the next page.
+   * @param rid[IN/OUT] the record id to advance
+   * @return rid
+   */
+  RecordId& next(RecordId& rid) const;
+
   /**
    * note the +1 part. The rid of the last record is endRid()-1.
    * @return (last record id + 1) of the RecordFile
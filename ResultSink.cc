@@ -0,0 +1,132 @@
+#include "ResultSink.h"
+#include <cstring>
+#include <strings.h>
+
+ResultSink::Format ResultSink::defaultFormat = ResultSink::TEXT;
+
+ResultSink::ResultSink(FILE* out, int attr)
+  : out(out), attr(attr), format(defaultFormat), buffer(BUFFER_SIZE), used(0)
+{
+}
+
+ResultSink::~ResultSink()
+{
+  flush();
+}
+
+RC ResultSink::flush()
+{
+  if (used == 0) return 0;
+
+  size_t n = fwrite(&buffer[0], 1, used, out);
+  bool failed = (n != (size_t)used);
+  used = 0;
+  if (failed || fflush(out) != 0) return RC_FILE_WRITE_FAILED;
+  return 0;
+}
+
+void ResultSink::addCount(int count)
+{
+  if (used + ROW_ROOM > BUFFER_SIZE) flush();
+  if (format == BINARY) {
+    int len = sizeof(int);
+    memcpy(&buffer[used], &len, sizeof(int));
+    memcpy(&buffer[used + sizeof(int)], &count, sizeof(int));
+    used += 2 * sizeof(int);
+  } else {
+    putInt(count);
+    putChar('\n');
+  }
+}
+
+void ResultSink::addText(int key, const char* value)
+{
+  switch (attr) {
+  case 1:  // key
+    putInt(key);
+    break;
+  case 2:  // value
+    putString(value);
+    break;
+  case 3:  // key 'value'
+    putInt(key);
+    putChar(' ');
+    putChar('\'');
+    putString(value);
+    putChar('\'');
+    break;
+  }
+  putChar('\n');
+}
+
+void ResultSink::addCsv(int key, const char* value)
+{
+  if (attr & 1) putInt(key);
+  if (attr == 3) putChar(',');
+  if (attr & 2) {
+    putChar('"');
+    for (const char* p = value; *p; p++) {
+      if (*p == '"') putChar('"');
+      putChar(*p);
+    }
+    putChar('"');
+  }
+  putChar('\n');
+}
+
+void ResultSink::addBinary(int key, const char* value)
+{
+  int len = 0;
+  int start = used;
+
+  // the length is filled in once the fields are in place
+  used += sizeof(int);
+  if (attr & 1) {
+    memcpy(&buffer[used], &key, sizeof(int));
+    used += sizeof(int);
+  }
+  if (attr & 2) putString(value);
+
+  len = used - start - sizeof(int);
+  memcpy(&buffer[start], &len, sizeof(int));
+}
+
+void ResultSink::putInt(int v)
+{
+  char digits[12];
+  int  n = 0;
+
+  // the digits come out backwards. the magnitude is taken as unsigned
+  // so that INT_MIN can be negated
+  unsigned u = (v < 0) ? 0u - (unsigned)v : (unsigned)v;
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+
+  if (v < 0) putChar('-');
+  while (n > 0) putChar(digits[--n]);
+}
+
+void ResultSink::putString(const char* s)
+{
+  size_t n = strlen(s);
+  memcpy(&buffer[used], s, n);
+  used += n;
+}
+
+RC ResultSink::setFormat(Format f)
+{
+  if (f != TEXT && f != CSV && f != BINARY) return RC_INVALID_ATTRIBUTE;
+  defaultFormat = f;
+  return 0;
+}
+
+RC ResultSink::parseFormat(const char* name, Format& f)
+{
+  if (strcasecmp(name, "text") == 0) f = TEXT;
+  else if (strcasecmp(name, "csv") == 0) f = CSV;
+  else if (strcasecmp(name, "binary") == 0) f = BINARY;
+  else return RC_INVALID_ATTRIBUTE;
+  return 0;
+}
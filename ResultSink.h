@@ -0,0 +1,104 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <cstdio>
+#include <vector>
+#include "Bruinbase.h"
+
+/**
+ * collects the result of a SELECT and writes it out in large blocks.
+ * rows are formatted by hand into a reusable buffer, which is written
+ * with one fwrite() whenever it fills up, and when the sink is flushed.
+ *
+ * the output format is one of
+ *   TEXT:   the console format. "key", "value", "key 'value'" or "count"
+ *           on a line per row
+ *   CSV:    one line per row, fields separated by commas. values are in
+ *           double quotes, with quotes inside doubled
+ *   BINARY: each row is a 4-byte length followed by that many bytes of
+ *           fields. a key or a count is a 4-byte int, and a value is its
+ *           bytes without the terminating NUL. integers are in host order
+ */
+class ResultSink {
+ public:
+  enum Format { TEXT, CSV, BINARY };
+
+  static const int BUFFER_SIZE = 64 * 1024;  // size of the output buffer
+
+  /**
+   * @param out[IN] the stream to write to
+   * @param attr[IN] what each row holds: 1 - key, 2 - value, 3 - both
+   */
+  ResultSink(FILE* out, int attr);
+
+  /**
+   * the rows not written yet are flushed.
+   */
+  ~ResultSink();
+
+  /**
+   * add a row to the result. only the fields given by attr are used.
+   * @param key[IN] the key of the row
+   * @param value[IN] the value of the row
+   */
+  void add(int key, const char* value)
+  {
+    // a row is never larger than a key, a value and some punctuation
+    if (used + ROW_ROOM > BUFFER_SIZE) flush();
+    switch (format) {
+    case TEXT:   addText(key, value); break;
+    case CSV:    addCsv(key, value); break;
+    case BINARY: addBinary(key, value); break;
+    }
+  }
+
+  /**
+   * add the row of a COUNT(*) result.
+   * @param count[IN] the # of matching tuples
+   */
+  void addCount(int count);
+
+  /**
+   * write out the buffered rows.
+   * @return error code. 0 if no error
+   */
+  RC flush();
+
+  /**
+   * set the format of the results written from now on.
+   * @param f[IN] the output format
+   * @return error code. 0 if no error
+   */
+  static RC setFormat(Format f);
+
+  /**
+   * parse a format name ("text", "csv" or "binary").
+   * @param name[IN] the name of the format
+   * @param f[OUT] the parsed format
+   * @return error code. 0 if no error
+   */
+  static RC parseFormat(const char* name, Format& f);
+
+ private:
+  // the most bytes a row takes: an int, a value with every character
+  // escaped, and the separators around them
+  static const int ROW_ROOM = 2 * 12 + 2 * 100 + 16;
+
+  void addText(int key, const char* value);
+  void addCsv(int key, const char* value);
+  void addBinary(int key, const char* value);
+
+  void putInt(int v);
+  void putChar(char c) { buffer[used++] = c; }
+  void putString(const char* s);
+
+  FILE*  out;     // the stream to write to
+  int    attr;    // the fields of a row
+  Format format;  // the output format
+  std::vector<char> buffer;  // rows not written yet
+  int    used;    // # of bytes in buffer
+
+  static Format defaultFormat;  // the format of new sinks
+};
+
+#endif // RESULTSINK_H
@@ -10,11 +10,19 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <unistd.h>
+#include <climits>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include "Bruinbase.h"
 #include "SqlEngine.h"
 #include "BTreeIndex.h"
+#include "Predicate.h"
+#include "ParallelScan.h"
+#include "Planner.h"
+#include "TableStats.h"
+#include "ResultSink.h"
 
 using namespace std;
 
@@ -22,6 +30,74 @@ using namespace std;
 extern FILE* sqlin;
 int sqlparse(void);
 
+char SqlEngine::readMode = 'r';
+
+// # of table pages read together
+static const int READ_BATCH = 64;
+
+// # of index entries whose table reads are sorted by rid together
+static const int HEAP_BATCH = 65536;
+
+/**
+ * orders entry numbers by the RecordId of the entry.
+ */
+struct RidOrder {
+  const RecordId* rids;
+  RidOrder(const RecordId* r) : rids(r) { }
+  bool operator()(int a, int b) const
+  { return rids[a] < rids[b] || (rids[a] == rids[b] && a < b); }
+};
+
+/**
+ * open the index of a table, if there is one. an index written before
+ * B+tree nodes had a header cannot be read; it is reported and left
+ * unused until the table is loaded again.
+ * @param btree[IN] the index to open
+ * @param table[IN] the table name
+ * @param mode[IN] the mode to open the index in
+ * @return error code. 0 if no error
+ */
+static RC openIndex(BTreeIndex& btree, const string& table, char mode)
+{
+  RC rc = btree.open(table + ".idx", mode);
+  if (rc == RC_INVALID_FILE_FORMAT) {
+    fprintf(stderr, "Warning: %s.idx has an old format and is not used. To rebuild it, "
+      "remove %s.tbl and %s.idx and load the table again WITH INDEX\n",
+      table.c_str(), table.c_str(), table.c_str());
+  }
+  return rc;
+}
+
+/**
+ * count the index entries that meet conditions on the key only.
+ * each range the conditions fold into is counted with two descents of
+ * the index. each key inside them excluded by NE is then counted and
+ * taken off.
+ * @param btree[IN] the index
+ * @param pred[IN] the conditions, all on the key
+ * @param count[OUT] the # of matching entries
+ * @return error code. 0 if no error
+ */
+static RC countKeys(BTreeIndex& btree, const Predicate& pred, int& count)
+{
+  RC rc;
+  const vector<int>& excluded = pred.excludedKeys();
+  vector<Predicate::KeyRange> ranges = pred.keyRanges();
+
+  count = 0;
+  for (unsigned r = 0; r < ranges.size(); r++) {
+    int n;
+    if ((rc = btree.countRange((int)ranges[r].low, (int)ranges[r].high, n)) < 0) return rc;
+    count += n;
+  }
+
+  for (unsigned i = 0; i < excluded.size(); i++) {
+    int n;
+    if ((rc = btree.countRange(excluded[i], excluded[i], n)) < 0) return rc;
+    count -= n;
+  }
+  return 0;
+}
 
 RC SqlEngine::run(FILE* commandline)
 {
@@ -36,6 +112,11 @@ RC SqlEngine::run(FILE* commandline)
 }
 
 RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
+{
+  return select(attr, table, vector<vector<SelCond> >(1, cond));
+}
+
+RC SqlEngine::select(int attr, const string& table, const vector<vector<SelCond> >& terms)
 {
   RecordFile rf;   // RecordFile containing the table
   RecordId   rid;  // record cursor for table scanning
@@ -44,8 +125,9 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   int    key;     
   string value;
   int    count;
-  int    diff;
 
+  Predicate  pred(terms);  // the WHERE clause, compiled once
+  ResultSink sink(stdout, attr);  // the matching tuples are written here
   BTreeIndex btree;
   rid.pid = 0;
   rid.sid = 1;
@@ -54,295 +136,307 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   cursor.eid=-1;
   cursor.pid=-1;
 
-  // open the table file
-  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+  // the key conditions cannot all hold. nothing is read
+  if (pred.isEmpty()) {
+    if (access((table + ".tbl").c_str(), F_OK) != 0) {
+      fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+      return RC_FILE_OPEN_FAILED;
+    }
+    if (attr == 4) sink.addCount(0);
+    return 0;
+  }
+
+  // open the table file and the index, if there is one
+  bool has_index = !openIndex(btree, table, readMode);
+  bool use_index = false;
+  bool index_only = false;
+  if ((rc = rf.open(table + ".tbl", readMode)) < 0) {
     fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    btree.close();
     return rc;
   }
-    int startKey=0;
-    bool startKeyInit=false;
-    bool key_inequality=false;
-    bool key_condition_exist=false;
-    bool avoid_index=false;
-    bool eq_set=false;
-    int eq_val;
-    bool gt_set=false;
-    int gt_val;
-    bool ge_set=false;
-    int ge_val;
-    bool count_from_beginning=true;
-    bool count_or_not_to_count=false;
-    int temp;
-
-    //conditions
-    for(int i=0;i<cond.size();i++)
+
+  // the statistics written at load time are used while the table is
+  // unchanged. otherwise they are collected again from the index
+  TableStats stats;
+  if (stats.load(table) < 0 || !stats.isCurrent(rf)
+      || (stats.indexHeight > 0) != has_index) {
+    if ((rc = stats.collect(rf, has_index ? &btree : NULL)) < 0) {
+      fprintf(stderr, "Error: while reading index of table %s\n", table.c_str());
+      goto exit_select;
+    }
+  }
+
+  // choose between scanning the table and searching the index
+  {
+    Planner::Plan plan = Planner::choose(stats, pred, attr, has_index);
+    use_index = (plan.access != Planner::TABLE_SCAN);
+    index_only = (plan.access == Planner::INDEX_ONLY);
+  }
+
+  //count(*) on the key alone comes from the subtree sizes in the index
+  if(index_only&&attr==4)
+  {
+    if ((rc = countKeys(btree, pred, count)) < 0)
     {
-      //if is a key, do, else nothing
-      if(cond[i].attr==1)
+      fprintf(stderr, "Error: while reading index of table %s\n", table.c_str());
+      goto exit_select;
+    }
+  }
+  else if(use_index)
+  {
+    //the walk starts at the first key of the first range the key
+    //conditions fold into. at the end of a range it skips ahead to the
+    //next one, and it stops at the first key past the last range
+    vector<Predicate::KeyRange> ranges=pred.keyRanges();
+    unsigned range=0;
+
+    //when every range is a single key, as for = and IN, all keys are
+    //looked up at once and the nodes on their paths are read once
+    bool points=true;
+    for(unsigned r=0;r<ranges.size();r++)
+      points=points&&ranges[r].low==ranges[r].high;
+    vector<int>      probeKeys;
+    vector<RecordId> probeRids;
+    size_t           probed=0;
+
+    //otherwise the leaves are read through an iterator that keeps the
+    //current leaf pinned and hands out its entries a batch at a time
+    IndexIterator it;
+    if(points)
+    {
+      vector<int> probes;
+      for(unsigned r=0;r<ranges.size();r++)
+        probes.push_back((int)ranges[r].low);
+      rc=btree.lookupBatch(&probes[0],probes.size(),probeKeys,probeRids);
+    }
+    else
+    {
+      //no key at or past the start leaves the cursor at the end of the
+      //leaves, and the scan returns nothing
+      rc=btree.locate((int)ranges[0].low,cursor);
+      if(rc==0||rc==RC_NO_SUCH_RECORD)
+        rc=btree.scan(cursor,it);
+    }
+    if (rc < 0)
+    {
+      fprintf(stderr, "Error: while reading index of table %s\n", table.c_str());
+      goto exit_select;
+    }
+
+    //entries are fetched from the table in rid order, a large batch at
+    //a time, so each table page is read once per batch even when the
+    //keys are scattered over the table
+    vector<int>      batchKeys(HEAP_BATCH);
+    vector<RecordId> batchRids(HEAP_BATCH);
+    vector<int>      order;
+    vector<char>     matched;
+    vector<string>   values;
+    PageRead         pages[READ_BATCH];
+    vector<int>      runs;
+    int              n;
+    bool             done=false;
+
+    //the table is only read if we print values or check them
+    bool need_value=!index_only;
+
+    while(!done)
+    {
+      //collect a batch of entries in key order
+      n=0;
+      if(points)
       {
-        if(cond[i].comp==SelCond::NE)
+        n=min((size_t)HEAP_BATCH,probeKeys.size()-probed);
+        copy(probeKeys.begin()+probed,probeKeys.begin()+probed+n,batchKeys.begin());
+        copy(probeRids.begin()+probed,probeRids.begin()+probed+n,batchRids.begin());
+        probed+=n;
+        done=(probed==probeKeys.size());
+      }
+      while(!points&&n<HEAP_BATCH)
+      {
+        int got=it.next(&batchKeys[n],&batchRids[n],min(READ_BATCH,HEAP_BATCH-n));
+        if(got<0)
         {
-          key_inequality=true;
-          continue;
+          rc=got;
+          fprintf(stderr, "Error: while reading index of table %s\n", table.c_str());
+          goto exit_select;
         }
-        else
-          key_condition_exist=true;
-
-        if(cond[i].comp==SelCond::EQ)
+        if(got==0)
         {
-          count_from_beginning=false;
-          temp=atoi(cond[i].value);
-
-          //set variables
-          startKey=temp;
-          startKeyInit=true;
- 
-          continue;
+          done=true;
+          break;
         }
-        else if(cond[i].comp==SelCond::GE)
+
+        //keep the entries inside a range. a key past the end of the
+        //current range moves on to the next range, and keys short of
+        //that range are dropped
+        int last=n+got;
+        for(int i=n;i<last;i++)
         {
-          count_from_beginning=false;
-          temp=atoi(cond[i].value);
-          if(startKeyInit)
+          while(range<ranges.size()&&batchKeys[i]>ranges[range].high)
+            range++;
+          if(range==ranges.size())
           {
-            if(temp>startKey)
-                startKey=temp;
-          }
-          else
-          {
-       
-            startKey=temp;
-            startKeyInit=true;
+            done=true;
+            break;
           }
+          if(batchKeys[i]<ranges[range].low)
+            continue;
+          batchKeys[n]=batchKeys[i];
+          batchRids[n]=batchRids[i];
+          n++;
         }
-        else if(cond[i].comp==SelCond::GT)
-        {
-
-          count_from_beginning=false;
-          temp=atoi(cond[i].value)+1;
+        if(done)
+          break;
 
-          if(startKeyInit)
-          {
-            if(temp>startKey)
-                startKey=temp;
-          }
-          else
+        //the next range starts past what was read. move the iterator
+        //to its first key
+        if(batchKeys[last-1]<ranges[range].low)
+        {
+          if ((rc = btree.seek((int)ranges[range].low, it)) < 0)
           {
- 
-            startKey=temp;
-            startKeyInit=true;
+            fprintf(stderr, "Error: while reading index of table %s\n", table.c_str());
+            goto exit_select;
           }
         }
       }
-    }
-
-    //cond on value and not on keys means have to start at beginning
-    //only saves time on small datasets
-     if(attr==2&&!key_condition_exist)
-    {
-      avoid_index=true;
-    }
-
-    //no key conditions besides key inequality
-    if(!key_condition_exist && key_inequality)
-    {
-      avoid_index=true;
-    }
-
-    if(attr==4||attr==3)
-    {
-      count_or_not_to_count=true;
-    }
-
-    //checks done
-    if(count_from_beginning&&count_or_not_to_count)
-    {
-      cursor.eid=0;
-      cursor.pid=0;
-    }
+      if(n==0)
+        break;
 
-  //index exists and we dont want to avoid the index
-  if(!btree.open(table + ".idx",'r')&&!avoid_index)
-  {
-      btree.locate(startKey,cursor);
+      matched.assign(n,0);
+      if(attr==2||attr==3)
+        values.resize(n);
 
-    while(btree.readForward(cursor,key,rid)==0)
-    {
-      //count(*) doesnt need values
-      if(attr!=4)
+      if(!need_value)
+      {
+        for(int b=0;b<n;b++)
+          matched[b]=pred.matchKey(batchKeys[b]);
+      }
+      else
       {
-        if ((rc = rf.read(rid, key, value)) < 0) 
+        //entries that fail on the key are dropped before the table is
+        //read. sort the rest by rid and split them into runs of entries
+        //sharing a page
+        order.clear();
+        for(int b=0;b<n;b++)
         {
-          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-          goto exit_select;
+          if(pred.matchKey(batchKeys[b]))
+            order.push_back(b);
         }
-      }
+        sort(order.begin(),order.end(),RidOrder(&batchRids[0]));
 
-      for(unsigned i=0;i<cond.size();i++)
-      {
-        if(cond[i].attr==1)
+        int fetch=order.size();
+        runs.clear();
+        for(int o=0;o<fetch;o++)
         {
-          diff=key-atoi(cond[i].value);
+          if(o==0||batchRids[order[o]].pid!=batchRids[order[o-1]].pid)
+            runs.push_back(o);
         }
-        else if(cond[i].attr==2)
+        int runCount=runs.size();
+        runs.push_back(fetch);
+
+        //keep up to READ_BATCH page reads in flight, starting the
+        //next one as soon as a page is done
+        for(int r=0;r<runCount&&r<READ_BATCH;r++)
         {
-          diff=strcmp(value.c_str(),cond[i].value);
+          if ((rc = rf.readAsync(batchRids[order[runs[r]]], pages[r])) < 0)
+          {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_select;
+          }
         }
 
-        switch(cond[i].comp)
+        for(int r=0;r<runCount;r++)
         {
-          case SelCond::EQ:
-            if(diff!=0)
+          PageRead& page=pages[r%READ_BATCH];
+          for(int o=runs[r];o<runs[r+1];o++)
+          {
+            int b=order[o];
+            if ((rc = rf.read(page, batchRids[b], key, value)) < 0)
             {
-              //key, we started from this key, if wasn't equal we done
-              if(cond[i].attr==1)
-                goto early_exit_select;
-              else//values not sorted so must continue
-                goto continue_check;
+              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+              goto exit_select;
             }
-            break;
-
-          case SelCond::NE:
-            if(diff==0)
-              goto continue_check;
-            break;
-
-          case SelCond::GT:
-            if(diff<=0)
-              goto continue_check;
-            break;
+            matched[b]=pred.matchValue(batchKeys[b],value.c_str());
+            if(matched[b]&&(attr==2||attr==3))
+              values[b]=value;
+          }
 
-          case SelCond::LT:
-            if(diff>=0)
+          if(r+READ_BATCH<runCount)
+          {
+            if ((rc = rf.readAsync(batchRids[order[runs[r+READ_BATCH]]], page)) < 0)
             {
-              //if key, then we hit max 
-              if(cond[i].attr==1)
-                goto early_exit_select;
-              goto continue_check;
+              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+              goto exit_select;
             }
-            break;
+          }
+        }
+      }
 
-          case SelCond::GE:
-            if(diff<0)
-              goto continue_check;
-            break;
+      //print the matches back in key order
+      for(int b=0;b<n;b++)
+      {
+        if(!matched[b])
+          continue;
 
-          case SelCond::LE:
-            if(diff>0)
-            {
-              //if key, then we hit max
-              if(cond[i].attr==1)
-                goto early_exit_select;
-              goto continue_check;
-            }
-            break;
-        }
+        // the condition is met for the tuple. 
+        // increase matching tuple counter
+        count++;
 
+        // print the tuple 
+        if(attr!=4)
+          sink.add(batchKeys[b],(attr==1) ? "" : values[b].c_str());
       }
-       
-      // the condition is met for the tuple. 
-      // increase matching tuple counter
-      count++;
-
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
-       continue_check:
-       if(cursor.eid==-1)
-        {
-          break;
-        }
     }
   }
   else//index doesnt exist, default implementation
   {
-    // scan the table file from the beginning
-
-    while (rid < rf.endRid()) {
-      // read the tuple
-      if ((rc = rf.read(rid, key, value)) < 0) {
-        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-        goto exit_select;
-      }
-
-      // check the conditions on the tuple
-      for (unsigned i = 0; i < cond.size(); i++) {
-        // compute the difference between the tuple value and the condition value
-        switch (cond[i].attr) {
-        case 1:
-  	diff = key - atoi(cond[i].value);
-  	break;
-        case 2:
-  	diff = strcmp(value.c_str(), cond[i].value);
-  	break;
-        }
-
-        // skip the tuple if any condition is not met
-        switch (cond[i].comp) {
-        case SelCond::EQ:
-  	if (diff != 0) goto next_tuple;
-  	break;
-        case SelCond::NE:
-  	if (diff == 0) goto next_tuple;
-  	break;
-        case SelCond::GT:
-  	if (diff <= 0) goto next_tuple;
-  	break;
-        case SelCond::LT:
-  	if (diff >= 0) goto next_tuple;
-  	break;
-        case SelCond::GE:
-  	if (diff < 0) goto next_tuple;
-  	break;
-        case SelCond::LE:
-  	if (diff > 0) goto next_tuple;
-  	break;
-        }
-      }
-
-      // the condition is met for the tuple. 
-      // increase matching tuple counter
-      count++;
-
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
-
-      // move to the next tuple
-      next_tuple:
-      ++rid;
+    // scan the table file from the beginning, spread over several
+    // threads. the rows come out in file order
+    if ((rc = ParallelScan::scan(rf, rid, pred, attr, sink, count)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
     }
   }
 
-  //early exit, invalid but still possibly need to print count(*)
-  early_exit_select:
-
   // print matching tuple count if "select count(*)"
   if (attr == 4) {
-    fprintf(stdout, "%d\n", count);
+    sink.addCount(count);
   }
   rc = 0;
 
   // close the table file and return
   exit_select:
+  sink.flush();
+  btree.close();
+  rf.close();
+  return rc;
+}
+
+RC SqlEngine::analyze(const string& table)
+{
+  RecordFile rf;     // RecordFile containing the table
+  BTreeIndex btree;  // the index of the table, if there is one
+  TableStats stats;
+  RecordId   start;  // the first record, as in a table scan
+  RC         rc;
+
+  start.pid = 0;
+  start.sid = 1;
+
+  if ((rc = rf.open(table + ".tbl", readMode)) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+  bool has_index = !openIndex(btree, table, readMode);
+
+  if ((rc = stats.analyze(rf, start, has_index ? &btree : NULL)) < 0) {
+    fprintf(stderr, "Error: while reading table %s\n", table.c_str());
+  } else if ((rc = stats.save(table)) < 0) {
+    fprintf(stderr, "Error: while writing the statistics of table %s\n", table.c_str());
+  }
+
+  btree.close();
   rf.close();
   return rc;
 }
@@ -357,6 +451,7 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
     RecordId rid;
     string line;
     BTreeIndex btree;
+    ExternalSort entries;
 
     //open stream
     fs.open(loadfile.c_str(),fstream::in);
@@ -373,7 +468,7 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
     {
         rc=rf.append(key,val,rid);
       int iterator=0;
-      rc=btree.open(table + ".idx",'w');
+      rc=openIndex(btree,table,'w');
       if(!rc)
       {
         int iterator=0;
@@ -388,10 +483,27 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
           if(rc)
             break;
 
-          rc=btree.insert(key,rid);
+          //collect the pairs and build the tree bottom-up at the end
+          rc=entries.add(key,rid);
           if(rc)
             break;
         }
+
+        //index the rows loaded so far even if a line failed
+        RC brc=entries.finish();
+        if(!brc)
+          brc=btree.bulkLoad(entries);
+        if(!rc)
+          rc=brc;
+
+        //keep the statistics of the table for the query planner
+        if(!rc)
+        {
+          TableStats stats;
+          if(!stats.collect(rf,&btree))
+            stats.save(table);
+        }
+
         //close tree
         btree.close();
       }
@@ -463,3 +575,9 @@ RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
 
     return 0;
 }
+
+RC SqlEngine::setMappedReads(bool mapped)
+{
+  readMode = mapped ? 'm' : 'r';
+  return 0;
+}
@@ -50,6 +50,18 @@ class SqlEngine {
    */
   static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds);
 
+  /**
+   * executes a SELECT statement whose WHERE clause has OR.
+   * the conditions of each term are ANDed together, and the terms are
+   * ORed together.
+   * @param attr[IN] attribute in the SELECT clause
+   * (1: key, 2: value, 3: *, 4: count(*))
+   * @param table[IN] the table name in the FROM clause
+   * @param terms[IN] the terms of the WHERE clause
+   * @return error code. 0 if no error
+   */
+  static RC select(int attr, const std::string& table, const std::vector<std::vector<SelCond> >& terms);
+
   /**
    * load a table from a load file.
    * @param table[IN] the table name in the LOAD command
@@ -59,6 +71,14 @@ class SqlEngine {
    */
   static RC load(const std::string& table, const std::string& loadfile, bool index);
 
+  /**
+   * collect the statistics of a table for the query planner, and keep
+   * them in the sidecar file of the table.
+   * @param table[IN] the table name in the ANALYZE command
+   * @return error code. 0 if no error
+   */
+  static RC analyze(const std::string& table);
+
   /**
    * parse a line from the load file into the (key, value) pair.
    * @param line[IN] a line from a load file
@@ -67,6 +87,17 @@ class SqlEngine {
    * @return error code. 0 if no error
    */
   static RC parseLoadLine(const std::string& line, int& key, std::string& value);
+
+  /**
+   * choose how SELECT and ANALYZE read the table and index files.
+   * by default the files are read through the buffer pool.
+   * @param mapped[IN] true to memory-map the files instead
+   * @return error code. 0 if no error
+   */
+  static RC setMappedReads(bool mapped);
+
+ private:
+  static char readMode;  // the mode SELECT and ANALYZE open files in
 };
 
 #endif /* SQLENGINE_H */
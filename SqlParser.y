@@ -8,12 +8,33 @@
 #include "Bruinbase.h"
 #include "SqlEngine.h" 
 #include "PageFile.h"
+#include "AsyncIO.h"
 
 int  sqllex(void);  
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
 extern "C" { int  sqlwrap() { return 1; } }
 
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
+typedef std::vector<std::vector<SelCond> > Terms;
+
+static void runSelect(int attr, const char* table, const Terms& terms)
+{
+  struct tms tmsbuf;
+  clock_t btime, etime;
+  int     bpagecnt, epagecnt;
+  int     basynccnt, easynccnt;
+
+  btime = times(&tmsbuf);
+  bpagecnt = PageFile::getPageReadCount();
+  basynccnt = AsyncIO::getReadCount();
+  SqlEngine::select(attr, table, terms);
+  etime = times(&tmsbuf);
+  epagecnt = PageFile::getPageReadCount();
+  easynccnt = AsyncIO::getReadCount();
+
+  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages, %d asynchronously\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt, easynccnt - basynccnt);
+}
+
+static void runAnalyze(const char* table)
 {
   struct tms tmsbuf;
   clock_t btime, etime;
@@ -21,11 +42,42 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
 
   btime = times(&tmsbuf);
   bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
+  if (SqlEngine::analyze(table) < 0) return;
   etime = times(&tmsbuf);
   epagecnt = PageFile::getPageReadCount();
 
-  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+  fprintf(stderr, "  -- %.3f seconds to run the analyze command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+}
+
+/* free the terms of a WHERE clause and the values of their conditions */
+static void freeTerms(Terms* terms)
+{
+  for (unsigned t = 0; t < terms->size(); t++) {
+    for (unsigned i = 0; i < (*terms)[t].size(); i++) {
+      free((*terms)[t][i].value);
+    }
+  }
+  delete terms;
+}
+
+/* AND two disjunctions together. every term of a is ANDed with every
+   term of b, each term getting its own copies of the values */
+static Terms* distribute(Terms* a, Terms* b)
+{
+  Terms* v = new Terms;
+  for (unsigned i = 0; i < a->size(); i++) {
+    for (unsigned j = 0; j < b->size(); j++) {
+      std::vector<SelCond> term = (*a)[i];
+      term.insert(term.end(), (*b)[j].begin(), (*b)[j].end());
+      for (unsigned k = 0; k < term.size(); k++) {
+        term[k].value = strdup(term[k].value);
+      }
+      v->push_back(term);
+    }
+  }
+  freeTerms(a);
+  freeTerms(b);
+  return v;
 }
 
 %}
@@ -35,17 +87,19 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
+  std::vector<std::vector<SelCond> >* terms;
 }
 
-%token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
-%token COMMA STAR LF
+%token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT ANALYZE AND OR IN
+%token COMMA STAR LF LPAREN RPAREN
 %token <string> INTEGER STRING ID
 %token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
 
 %type <integer> attributes attribute comparator
 %type <string> table value
 %type <cond> condition
-%type <conds> conditions
+%type <conds> values
+%type <terms> disjunction conjunction term
 %%
 
 commands:
@@ -56,6 +110,7 @@ commands:
 command:
         load_command { fprintf(stdout, "Bruinbase> "); }
 	| select_command { fprintf(stdout, "Bruinbase> "); }
+	| analyze_command { fprintf(stdout, "Bruinbase> "); }
 	| quit_command
 	| error LF { fprintf(stdout, "Bruinbase> "); }
 	| LF { fprintf(stdout, "Bruinbase> "); }
@@ -80,31 +135,69 @@ load_command:
 
 select_command:
 	SELECT attributes FROM table LF {
-   	        std::vector<SelCond> conds;
-		runSelect($2, $4, conds);
+   	        Terms terms(1);
+		runSelect($2, $4, terms);
 		free($4);
 	}
-	| SELECT attributes FROM table WHERE conditions LF {
+	| SELECT attributes FROM table WHERE disjunction LF {
 	        runSelect($2, $4, *$6);
 	  	free($4);
-	  	for (unsigned i = 0; i < $6->size(); i++) {
-		    free((*$6)[i].value);
-		}
-	  	delete $6;
+	  	freeTerms($6);
+	}
+	;
+
+analyze_command:
+	ANALYZE table LF {
+		runAnalyze($2);
+		free($2);
+	}
+	;
+
+disjunction:
+	conjunction { $$ = $1; }
+	| disjunction OR conjunction {
+	  $1->insert($1->end(), $3->begin(), $3->end());
+	  $$ = $1;
+	  delete $3;
 	}
 	;
 
-conditions:
+conjunction:
+	term { $$ = $1; }
+	| conjunction AND term { $$ = distribute($1, $3); }
+	;
+
+term:
 	condition {
-	  std::vector<SelCond>* v = new std::vector<SelCond>;
-	  v->push_back(*$1);
-	  $$ = v;
-          delete $1;
+	  $$ = new Terms(1, std::vector<SelCond>(1, *$1));
+	  delete $1;
+	}
+	| attribute IN LPAREN values RPAREN {
+	  /* each value of the list becomes a term of its own, testing for
+	     equality */
+	  $$ = new Terms;
+	  for (unsigned i = 0; i < $4->size(); i++) {
+	    (*$4)[i].attr = $1;
+	    $$->push_back(std::vector<SelCond>(1, (*$4)[i]));
+	  }
+	  delete $4;
+	}
+	| LPAREN disjunction RPAREN { $$ = $2; }
+	;
+
+values:
+	value {
+	  SelCond c;
+	  c.comp = SelCond::EQ;
+	  c.value = $1;
+	  $$ = new std::vector<SelCond>(1, c);
 	}
-	| conditions AND condition {
-	  $1->push_back(*$3);
+	| values COMMA value {
+	  SelCond c;
+	  c.comp = SelCond::EQ;
+	  c.value = $3;
+	  $1->push_back(c);
 	  $$ = $1;
-          delete $3;
 	}
 	;
 
@@ -0,0 +1,513 @@
+#include "TableStats.h"
+#include "ParallelScan.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+
+using std::string;
+using std::vector;
+using std::max;
+using std::min;
+
+// the first words of a statistics file. version 1 files end after the
+// key histogram
+static const int STATS_MAGIC = 0x53544253;
+static const int STATS_VERSION = 2;
+
+// the share of rows guessed for a condition the statistics say nothing of
+static const double DEFAULT_EQ_SHARE = 0.005;
+static const double DEFAULT_RANGE_SHARE = 1.0 / 3;
+
+TableStats::TableStats()
+  : records(0), rows(0), pages(0), indexHeight(0), leafEntries(0),
+    keyDistinct(0), valueDistinct(0)
+{
+}
+
+/**
+ * @return # of record slots before rid, with recordsPerPage slots a page
+ */
+static int slotsBefore(const RecordId& rid, int recordsPerPage)
+{
+  return rid.pid * recordsPerPage + rid.sid;
+}
+
+RC TableStats::collect(const RecordFile& rf, BTreeIndex* index)
+{
+  RC rc;
+  const RecordId& end = rf.endRid();
+
+  records = slotsBefore(end, rf.recordsPerPage());
+  rows = records;
+  pages = end.pid + (end.sid > 0 ? 1 : 0);
+  indexHeight = 0;
+  leafEntries = 0;
+  keyBounds.clear();
+  keyDistinct = valueDistinct = 0;
+  keyMcvs.clear();
+  keyFreqs.clear();
+  valueBounds.clear();
+  valueMcvs.clear();
+  valueFreqs.clear();
+  if (index == NULL) return 0;
+
+  indexHeight = index->getTreeHeight();
+  leafEntries = index->getLeafCapacity();
+
+  if ((rc = index->getEntryCount(rows)) < 0) return rc;
+  if (rows == 0) return 0;
+
+  // bound i is the key of rank i * (rows - 1) / buckets
+  int buckets = (rows < BUCKETS) ? rows : BUCKETS;
+  keyBounds.resize(buckets + 1);
+  for (int i = 0; i <= buckets; i++) {
+    int r = (int)((long long)i * (rows - 1) / buckets);
+    if ((rc = index->keyAtRank(r, keyBounds[i])) < 0) {
+      keyBounds.clear();
+      return (rc == RC_NO_SUCH_RECORD) ? 0 : rc;
+    }
+  }
+  return 0;
+}
+
+//
+// the sketches ANALYZE builds in its pass over the table
+//
+
+/**
+ * scramble the bits of x (the finalizer of MurmurHash3).
+ */
+static unsigned long long mix(unsigned long long x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * hash a NUL-terminated string (FNV-1a, then scrambled).
+ */
+static unsigned long long hashString(const char* s)
+{
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  for (; *s; s++) {
+    h ^= (unsigned char)*s;
+    h *= 0x100000001b3ULL;
+  }
+  return mix(h);
+}
+
+/**
+ * estimates the # of distinct items among many with a few KB of
+ * registers. an item is hashed, the first BITS bits of the hash choose
+ * a register, and the register keeps the longest run of leading zeros
+ * seen in the rest. sketches of parts of a column are merged by keeping
+ * the larger register of each pair.
+ */
+class HyperLogLog {
+ public:
+  static const int BITS = 12;  // 4096 registers, about 1.6% error
+
+  HyperLogLog() : registers(1 << BITS, 0) { }
+
+  void add(unsigned long long hash)
+  {
+    unsigned long long rest = hash << BITS;
+    int run = (rest == 0) ? 64 - BITS + 1 : __builtin_clzll(rest) + 1;
+    unsigned char& r = registers[hash >> (64 - BITS)];
+    if (run > r) r = run;
+  }
+
+  void merge(const HyperLogLog& other)
+  {
+    for (unsigned i = 0; i < registers.size(); i++) {
+      registers[i] = max(registers[i], other.registers[i]);
+    }
+  }
+
+  double estimate() const
+  {
+    double m = registers.size();
+    double sum = 0;
+    int    zeros = 0;
+
+    for (unsigned i = 0; i < registers.size(); i++) {
+      sum += ldexp(1.0, -registers[i]);
+      if (registers[i] == 0) zeros++;
+    }
+
+    // few items leave registers empty, and counting those is closer
+    double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) e = m * log(m / zeros);
+    return e;
+  }
+
+ private:
+  vector<unsigned char> registers;
+};
+
+/**
+ * a row kept in the sample, with the hash of its record id.
+ */
+struct SampledRow {
+  unsigned long long priority;
+  int                key;
+  string             value;
+
+  bool operator<(const SampledRow& other) const { return priority < other.priority; }
+};
+
+/**
+ * the task of ANALYZE. every thread counts the rows it reads, sketches
+ * their keys and values, and keeps the SAMPLE_ROWS rows of lowest
+ * priority it has seen. as the priority is a hash of the record id, the
+ * lowest SAMPLE_ROWS of the merged samples are a uniform sample of the
+ * table, the same one whatever the # of threads.
+ */
+class AnalyzeTask : public ParallelScan::Task {
+ public:
+  struct Partial {
+    long long   rows;
+    HyperLogLog keys;
+    HyperLogLog values;
+    std::priority_queue<SampledRow> sample;  // the highest priority on top
+
+    Partial() : rows(0) { }
+  };
+
+  AnalyzeTask(const RecordFile& rf, int threads) : rf(rf), parts(threads) { }
+
+  RC run(int thread, int /*morsel*/, const RecordId& from, const RecordId& to)
+  {
+    RC          rc;
+    RecordBatch batch;
+    RecordId    rid = from;
+    Partial&    p = parts[thread];
+
+    while (rid < to) {
+      if ((rc = rf.readBatch(rid, to, ParallelScan::BATCH_RECORDS, batch)) < 0) return rc;
+      if (batch.size() == 0) break;
+
+      p.rows += batch.size();
+      for (int i = 0; i < batch.size(); i++) {
+        int key = batch.keys()[i];
+        p.keys.add(mix((unsigned)key));
+        p.values.add(hashString(batch.value(i)));
+
+        RecordId r = batch.rid(i);
+        unsigned long long priority = mix(((unsigned long long)r.pid << 32) | (unsigned)r.sid);
+        if ((int)p.sample.size() < TableStats::SAMPLE_ROWS) {
+          SampledRow row = { priority, key, batch.value(i) };
+          p.sample.push(row);
+        } else if (priority < p.sample.top().priority) {
+          SampledRow row = { priority, key, batch.value(i) };
+          p.sample.pop();
+          p.sample.push(row);
+        }
+      }
+    }
+    return 0;
+  }
+
+  const RecordFile& rf;
+  vector<Partial>   parts;  // the outcome, per thread
+};
+
+/**
+ * pick the bounds of an equi-depth histogram of sorted items.
+ */
+template<class T>
+static void pickBounds(const vector<T>& sorted, vector<T>& bounds)
+{
+  int n = sorted.size();
+  int buckets = (n < TableStats::BUCKETS) ? n : TableStats::BUCKETS;
+
+  bounds.clear();
+  if (n == 0) return;
+  for (int i = 0; i <= buckets; i++) {
+    bounds.push_back(sorted[(long long)i * (n - 1) / buckets]);
+  }
+}
+
+/**
+ * pick the most common of sorted items: those that occur more than once
+ * and at least a quarter more often than the average item.
+ */
+template<class T>
+static void pickMcvs(const vector<T>& sorted, vector<T>& mcvs, vector<double>& freqs)
+{
+  vector<std::pair<int, int> > runs;  // (length, start) of each run of equal items
+  int n = sorted.size();
+
+  for (int i = 0, j; i < n; i = j) {
+    for (j = i + 1; j < n && !(sorted[i] < sorted[j]); j++) ;
+    runs.push_back(std::make_pair(j - i, i));
+  }
+  std::sort(runs.rbegin(), runs.rend());
+
+  mcvs.clear();
+  freqs.clear();
+  for (unsigned r = 0; r < runs.size() && (int)mcvs.size() < TableStats::MCV_COUNT; r++) {
+    int length = runs[r].first;
+    if (length < 2 || length * (double)runs.size() < 1.25 * n) break;
+    mcvs.push_back(sorted[runs[r].second]);
+    freqs.push_back((double)length / n);
+  }
+}
+
+RC TableStats::analyze(const RecordFile& rf, const RecordId& start, BTreeIndex* index)
+{
+  RC  rc;
+  int threads = ParallelScan::threadsFor(rf, start);
+  AnalyzeTask task(rf, threads);
+
+  // the sizes and the shape of the index
+  if ((rc = collect(rf, index)) < 0) return rc;
+
+  if ((rc = ParallelScan::run(rf, start, task)) < 0) return rc;
+
+  // merge the parts of the threads
+  HyperLogLog keys, values;
+  vector<SampledRow> sample;
+  long long total = 0;
+  for (int t = 0; t < threads; t++) {
+    AnalyzeTask::Partial& p = task.parts[t];
+    total += p.rows;
+    keys.merge(p.keys);
+    values.merge(p.values);
+    for (; !p.sample.empty(); p.sample.pop()) sample.push_back(p.sample.top());
+  }
+  std::sort(sample.begin(), sample.end());
+  if ((int)sample.size() > SAMPLE_ROWS) sample.resize(SAMPLE_ROWS);
+
+  rows = total;
+  keyDistinct = min(keys.estimate(), (double)rows);
+  valueDistinct = min(values.estimate(), (double)rows);
+
+  // the histograms and the MCVs come from the sample
+  vector<int>    sampleKeys;
+  vector<string> sampleValues;
+  for (unsigned i = 0; i < sample.size(); i++) {
+    sampleKeys.push_back(sample[i].key);
+    sampleValues.push_back(sample[i].value);
+  }
+  std::sort(sampleKeys.begin(), sampleKeys.end());
+  std::sort(sampleValues.begin(), sampleValues.end());
+
+  pickBounds(sampleKeys, keyBounds);
+  pickBounds(sampleValues, valueBounds);
+  pickMcvs(sampleKeys, keyMcvs, keyFreqs);
+  pickMcvs(sampleValues, valueMcvs, valueFreqs);
+  return 0;
+}
+
+bool TableStats::isCurrent(const RecordFile& rf) const
+{
+  return records == slotsBefore(rf.endRid(), rf.recordsPerPage());
+}
+
+/**
+ * estimate the share of rows equal to a constant: its frequency if it is
+ * an MCV, or else an equal part of the rows the MCVs leave.
+ */
+template<class T>
+static double equalShare(const T& v, const vector<T>& mcvs, const vector<double>& freqs,
+                         double distinct)
+{
+  double rest = 1;
+
+  for (unsigned i = 0; i < mcvs.size(); i++) {
+    if (mcvs[i] == v) return freqs[i];
+    rest -= freqs[i];
+  }
+  if (distinct <= 0) return -1;
+  return max(rest, 0.0) / max(distinct - mcvs.size(), 1.0);
+}
+
+double TableStats::estimateKeys(long long low, long long high) const
+{
+  if (low > high || rows == 0) return 0;
+
+  if (low == high && keyDistinct > 0) {
+    return rows * equalShare((int)low, keyMcvs, keyFreqs, keyDistinct);
+  }
+
+  // without a histogram, guess a tenth of the table for a range
+  // and a single row for a key
+  if (keyBounds.empty()) {
+    if (low == high) return 1;
+    if (low == INT_MIN && high == INT_MAX) return rows;
+    return rows / 10.0;
+  }
+
+  int buckets = keyBounds.size() - 1;
+  double perBucket = (double)rows / buckets;
+  double estimate = 0;
+
+  for (int i = 0; i < buckets; i++) {
+    long long lb = keyBounds[i];
+    long long ub = keyBounds[i + 1];
+    long long from = max(low, lb);
+    long long to = min(high, ub);
+    if (from > to) continue;
+
+    // the keys are taken to be spread evenly over the bucket
+    estimate += perBucket * (double)(to - from + 1) / (double)(ub - lb + 1);
+  }
+
+  // a key inside the key range is taken to be there at least once
+  return max(estimate, (low <= keyBounds[buckets] && high >= keyBounds[0]) ? 1.0 : 0.0);
+}
+
+double TableStats::estimateValues(SelCond::Comparator comp, const char* operand) const
+{
+  double eq = equalShare(string(operand), valueMcvs, valueFreqs, valueDistinct);
+  if (eq < 0) eq = DEFAULT_EQ_SHARE;
+
+  if (comp == SelCond::EQ) return eq;
+  if (comp == SelCond::NE) return 1 - eq;
+
+  // the share of rows below the operand, from the bucket it falls in.
+  // an operand inside a bucket is taken to split it in half
+  double below = DEFAULT_RANGE_SHARE;
+  if (valueBounds.size() >= 2) {
+    int buckets = valueBounds.size() - 1;
+    if (valueBounds[0].compare(operand) >= 0) {
+      below = 0;
+    } else if (valueBounds[buckets].compare(operand) < 0) {
+      below = 1;
+    } else {
+      int b = std::lower_bound(valueBounds.begin(), valueBounds.end(), string(operand))
+              - valueBounds.begin();
+      below = (b - 0.5) / buckets;
+    }
+  }
+
+  double share = 0;
+  switch (comp) {
+  case SelCond::LT: share = below; break;
+  case SelCond::LE: share = below + eq; break;
+  case SelCond::GT: share = 1 - below - eq; break;
+  case SelCond::GE: share = 1 - below; break;
+  default: break;
+  }
+  return min(max(share, 0.0), 1.0);
+}
+
+//
+// reading and writing the sidecar file. a list is written as its length
+// followed by its items, and a string as its length followed by its bytes
+//
+
+template<class T>
+static bool putList(FILE* f, const vector<T>& v)
+{
+  int n = v.size();
+  if (fwrite(&n, sizeof(int), 1, f) != 1) return false;
+  return n == 0 || fwrite(&v[0], sizeof(T), n, f) == (size_t)n;
+}
+
+template<class T>
+static bool getList(FILE* f, vector<T>& v)
+{
+  int n;
+  if (fread(&n, sizeof(int), 1, f) != 1 || n < 0) return false;
+  v.resize(n);
+  return n == 0 || fread(&v[0], sizeof(T), n, f) == (size_t)n;
+}
+
+static bool putStrings(FILE* f, const vector<string>& v)
+{
+  int n = v.size();
+  if (fwrite(&n, sizeof(int), 1, f) != 1) return false;
+  for (int i = 0; i < n; i++) {
+    int len = v[i].size();
+    if (fwrite(&len, sizeof(int), 1, f) != 1) return false;
+    if (fwrite(v[i].data(), 1, len, f) != (size_t)len) return false;
+  }
+  return true;
+}
+
+static bool getStrings(FILE* f, vector<string>& v)
+{
+  int  n, len;
+  char buf[RecordFile::MAX_VALUE_LENGTH + 1];
+
+  if (fread(&n, sizeof(int), 1, f) != 1 || n < 0) return false;
+  v.clear();
+  for (int i = 0; i < n; i++) {
+    if (fread(&len, sizeof(int), 1, f) != 1) return false;
+    if (len < 0 || len > RecordFile::MAX_VALUE_LENGTH) return false;
+    if (fread(buf, 1, len, f) != (size_t)len) return false;
+    v.push_back(string(buf, len));
+  }
+  return true;
+}
+
+RC TableStats::load(const string& table)
+{
+  FILE* f;
+  int   header[7];
+  bool  ok;
+
+  if ((f = fopen((table + ".sts").c_str(), "rb")) == NULL) return RC_FILE_OPEN_FAILED;
+
+  // magic, version, records, rows, pages, indexHeight, leafEntries
+  ok = fread(header, sizeof(int), 7, f) == 7;
+  if (ok && (header[0] != STATS_MAGIC || header[1] < 1 || header[1] > STATS_VERSION)) {
+    fclose(f);
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  *this = TableStats();
+  if (ok) {
+    records = header[2];
+    rows = header[3];
+    pages = header[4];
+    indexHeight = header[5];
+    leafEntries = header[6];
+    ok = getList(f, keyBounds);
+  }
+  if (ok && header[1] >= 2) {
+    ok = fread(&keyDistinct, sizeof(double), 1, f) == 1
+      && fread(&valueDistinct, sizeof(double), 1, f) == 1
+      && getList(f, keyMcvs) && getList(f, keyFreqs)
+      && getStrings(f, valueBounds)
+      && getStrings(f, valueMcvs) && getList(f, valueFreqs)
+      && keyMcvs.size() == keyFreqs.size() && valueMcvs.size() == valueFreqs.size();
+  }
+
+  fclose(f);
+  if (!ok) {
+    *this = TableStats();
+    return RC_FILE_READ_FAILED;
+  }
+  return 0;
+}
+
+RC TableStats::save(const string& table) const
+{
+  FILE* f;
+  int   header[7] = { STATS_MAGIC, STATS_VERSION, records, rows, pages,
+                      indexHeight, leafEntries };
+  bool  ok;
+
+  if ((f = fopen((table + ".sts").c_str(), "wb")) == NULL) return RC_FILE_OPEN_FAILED;
+
+  ok = fwrite(header, sizeof(int), 7, f) == 7
+    && putList(f, keyBounds)
+    && fwrite(&keyDistinct, sizeof(double), 1, f) == 1
+    && fwrite(&valueDistinct, sizeof(double), 1, f) == 1
+    && putList(f, keyMcvs) && putList(f, keyFreqs)
+    && putStrings(f, valueBounds)
+    && putStrings(f, valueMcvs) && putList(f, valueFreqs);
+
+  if (fclose(f) != 0 || !ok) return RC_FILE_WRITE_FAILED;
+  return 0;
+}
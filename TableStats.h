@@ -0,0 +1,114 @@
+#ifndef TABLESTATS_H
+#define TABLESTATS_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include "SqlEngine.h"
+
+/**
+ * what the query planner knows about a table: its size, the shape of its
+ * index, and how its keys and values are distributed.
+ *
+ * a column is summarized by an equi-depth histogram. its bounds split
+ * the column in order into buckets holding the same # of rows, so buckets
+ * are narrow where the rows are dense. a range is estimated to hold the
+ * rows of the buckets it covers, counting a partly covered bucket in
+ * proportion to the part covered. ANALYZE adds the # of distinct keys and
+ * values and their most common values (MCVs) with their frequencies, and
+ * a histogram of the values.
+ *
+ * the statistics are kept in a sidecar file next to the table
+ * (<table>.sts), written when the table is loaded or analyzed.
+ */
+class TableStats {
+ public:
+  static const int BUCKETS = 32;        // # of buckets of a histogram
+  static const int MCV_COUNT = 10;      // most MCVs kept per column
+  static const int SAMPLE_ROWS = 30000; // # of rows ANALYZE samples
+
+  TableStats();
+
+  /**
+   * collect the statistics of a table. the sizes come from the end of
+   * the table file and from the entry count of the index, and the key
+   * histogram is read off the index, one root-to-leaf path per bound.
+   * without an index only the sizes are known.
+   * @param rf[IN] the table file, open
+   * @param index[IN] the index of the table, open. NULL if there is none
+   * @return error code. 0 if no error
+   */
+  RC collect(const RecordFile& rf, BTreeIndex* index);
+
+  /**
+   * collect the full statistics of a table in one parallel pass over the
+   * table file. every row is counted and fed to a HyperLogLog sketch of
+   * the keys and one of the values. a uniform sample of SAMPLE_ROWS rows,
+   * the ones whose record ids hash lowest, is kept as well, and the
+   * histograms and the MCVs are built from it.
+   * @param rf[IN] the table file, open
+   * @param start[IN] the first record of the table
+   * @param index[IN] the index of the table, open. NULL if there is none
+   * @return error code. 0 if no error
+   */
+  RC analyze(const RecordFile& rf, const RecordId& start, BTreeIndex* index);
+
+  /**
+   * @param rf[IN] the table file, open
+   * @return true if the statistics were collected from the table as it is
+   */
+  bool isCurrent(const RecordFile& rf) const;
+
+  /**
+   * estimate the # of rows with a key between low and high.
+   * @param low[IN] the smallest key
+   * @param high[IN] the largest key
+   * @return the estimated # of rows
+   */
+  double estimateKeys(long long low, long long high) const;
+
+  /**
+   * estimate the share of rows whose value meets a condition.
+   * @param comp[IN] the comparator of the condition
+   * @param operand[IN] the constant the value is compared with
+   * @return the estimated share, 0 to 1
+   */
+  double estimateValues(SelCond::Comparator comp, const char* operand) const;
+
+  /**
+   * read the statistics of a table from its sidecar file.
+   * @param table[IN] the name of the table
+   * @return error code. 0 if no error
+   */
+  RC load(const std::string& table);
+
+  /**
+   * write the statistics of a table to its sidecar file.
+   * @param table[IN] the name of the table
+   * @return error code. 0 if no error
+   */
+  RC save(const std::string& table) const;
+
+  int records;      // # of record slots up to the end of the table file
+  int rows;         // # of rows
+  int pages;        // # of pages of the table file
+  int indexHeight;  // height of the index, 0 if there is no index
+  int leafEntries;  // # of entries an index leaf holds when full
+
+  // the bounds of the key histogram, bucket i being
+  // [keyBounds[i], keyBounds[i+1]]. empty if not known
+  std::vector<int> keyBounds;
+
+  // the rest is known only after ANALYZE
+  double keyDistinct;    // estimated # of distinct keys, 0 if not known
+  double valueDistinct;  // estimated # of distinct values, 0 if not known
+  std::vector<int>         keyMcvs;     // the most common keys
+  std::vector<double>      keyFreqs;    // the share of rows of each
+  std::vector<std::string> valueBounds; // the bounds of the value histogram
+  std::vector<std::string> valueMcvs;   // the most common values
+  std::vector<double>      valueFreqs;  // the share of rows of each
+};
+
+#endif // TABLESTATS_H
@@ -387,8 +387,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 26
-#define YY_END_OF_BUFFER 27
+#define YY_NUM_RULES 30
+#define YY_END_OF_BUFFER 31
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -396,149 +396,178 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[113] =
+static yyconst flex_int16_t yy_accept[124] =
     {   0,
-        0,    0,   27,   26,   25,   23,   26,   26,   22,   21,
-       26,   18,   24,   15,   12,   14,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   25,   23,    0,
-       19,   18,   17,   13,   16,   20,   20,   20,   20,   20,
-       20,   20,   11,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   10,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,    8,    2,   20,
-        4,    7,   20,   20,    5,   20,   20,   20,   20,   20,
-
-        6,   20,    3,   20,   20,    0,    1,    0,    0,    0,
-        9,    0
+         0,     0,    31,    30,    29,    27,    30,    30,    25,    26,
+        24,    23,    30,    20,    28,    17,    14,    16,    22,    22,
+        22,    22,    22,    22,    22,    22,    22,    22,    22,    22,
+        22,    22,    22,    22,    22,    22,    22,    22,    22,    29,
+        27,     0,    21,    20,    19,    15,    18,    22,    22,    22,
+        22,    22,    13,    22,    12,    22,    22,    22,    22,    22,
+        22,    22,    22,    13,    22,    22,    22,    22,    22,    22,
+        11,    22,    22,    22,    22,    22,    22,    22,    22,    22,
+        22,    22,    22,    22,    22,    22,    22,    22,    22,    22,
+        22,    22,     8,     2,    22,     4,     7,    22,    22,     5,
+
+        22,    22,    22,    22,    22,    22,    22,     6,    22,     3,
+        22,    22,    22,    22,     0,     1,    22,     0,    10,     0,
+         0,     9,     0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
-        1,    1,    4,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    2,    1,    1,    1,    1,    1,    1,    5,    6,
-        7,    8,    1,    9,   10,    1,    1,   11,   11,   11,
-       11,   11,   11,   11,   11,   11,   11,    1,   12,   13,
-       14,   15,    1,    1,   16,   17,   18,   19,   20,   21,
-       17,   22,   23,   17,   17,   24,   25,   26,   27,   17,
-       28,   29,   30,   31,   32,   17,   33,   34,   17,   17,
-        1,    1,    1,    1,   35,    1,   36,   17,   37,   38,
-
-       39,   40,   17,   41,   42,   17,   17,   43,   44,   45,
-       46,   17,   47,   48,   49,   50,   51,   17,   52,   53,
-       17,   17,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1
+         1,     1,     1,     1,     1,     1,     1,     1,     2,     3,
+         1,     1,     4,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     2,     1,     1,     1,     1,     1,     1,     5,     6,
+         7,     8,     1,     9,    10,     1,     1,    11,    11,    11,
+        11,    11,    11,    11,    11,    11,    11,     1,    12,    13,
+        14,    15,     1,     1,    16,    17,    18,    19,    20,    21,
+        17,    22,    23,    17,    17,    24,    25,    26,    27,    17,
+        28,    29,    30,    31,    32,    17,    33,    34,    35,    36,
+         1,     1,     1,     1,    37,     1,    38,    17,    39,    40,
+
+        41,    42,    17,    43,    44,    17,    17,    45,    46,    47,
+        48,    17,    49,    50,    51,    52,    53,    17,    54,    55,
+        56,    57,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1
     } ;
 
-static yyconst flex_int32_t yy_meta[54] =
+static yyconst flex_int32_t yy_meta[58] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    2,
-        2,    1,    1,    1,    1,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1
     } ;
 
-static yyconst flex_int16_t yy_base[115] =
+static yyconst flex_int16_t yy_base[124] =
     {   0,
-        0,    0,  144,  145,  141,  145,  139,  136,  145,  145,
-      129,  128,  145,   40,  145,  124,  111,    0,  109,  101,
-      105,  107,  105,  102,   98,  109,   34,   83,   81,   73,
-       77,   79,   77,   74,   70,   81,   17,  117,  145,  113,
-      145,  106,  145,  145,  145,    0,   97,   83,   91,   86,
-       93,   95,    0,   87,   85,   88,   76,   68,   54,   62,
-       57,   64,   65,   58,   56,   59,   47,    0,   70,   64,
-       69,   73,   73,   60,   70,   60,   66,   42,   36,   41,
-       45,   45,   32,   42,   32,   38,   47,    0,    0,   43,
-        0,    0,   58,   55,    0,   24,   20,   35,   32,   64,
-
-        0,   38,    0,   62,   17,   58,    0,   57,   57,   56,
-      145,  145,   59,   60
+         1,     1,     1,   263,    59,   263,    60,    63,   263,   263,
+       263,   263,   121,     1,   263,   122,   263,   124,   123,    36,
+        96,    91,    97,   101,   101,   100,    98,   111,   159,    88,
+       135,   129,   135,   139,   139,   138,   136,   149,   148,     1,
+       263,     1,   263,     1,   263,   263,   263,     1,   177,   162,
+       172,   170,   179,   183,     1,   177,   177,   182,   172,   166,
+       152,   163,   160,   169,   172,   167,   167,   172,   162,   191,
+         1,   190,   186,   193,   199,   201,   190,   202,   194,   202,
+       180,   179,   175,   182,   188,   190,   179,   191,   183,   191,
+       200,   205,     1,     1,   203,     1,     1,   220,   219,     1,
+
+       184,   189,   187,   204,   203,   209,   240,     1,   216,     1,
+       191,   243,   198,   231,   252,     1,   212,   246,     1,   255,
+         1,   263,   263
     } ;
 
-static yyconst flex_int16_t yy_def[115] =
+static yyconst flex_int16_t yy_def[124] =
     {   0,
-      112,    1,  112,  112,  112,  112,  112,  113,  112,  112,
-      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  112,  112,  113,
-      112,  112,  112,  112,  112,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-
-      114,  114,  114,  114,  114,  112,  114,  112,  112,  112,
-      112,    0,  112,  112
+       123,     1,   123,   123,   123,   123,   123,     1,   123,   123,
+       123,   123,   123,    13,   123,   123,   123,   123,    13,    19,
+        20,    20,    20,    19,    20,    20,    20,    20,    20,    20,
+        20,    20,    20,    20,    20,    20,    20,    20,    20,     5,
+       123,     8,   123,    13,   123,   123,   123,    20,    20,    20,
+        20,    20,    20,    20,    20,    20,    20,    20,    20,    20,
+        20,    20,    20,    20,    20,    20,    20,    20,    20,    20,
+        20,    19,    20,    20,    20,    20,    20,    20,    20,    20,
+        20,    20,    20,    20,    20,    20,    20,    20,    20,    20,
+        20,    20,    20,    20,    20,    20,    20,    20,    20,    20,
+
+        20,    20,    20,    20,    20,    20,    20,    20,    20,    20,
+        20,    20,    20,    20,   123,    20,    20,   115,    20,   123,
+       120,   123,     0
     } ;
 
-static yyconst flex_int16_t yy_nxt[199] =
+static yyconst flex_int16_t yy_nxt[321] =
     {   0,
-        4,    5,    6,    7,    8,    4,    4,    9,   10,   11,
-       12,   13,   14,   15,   16,   17,   18,   19,   18,   20,
-       21,   18,   22,   23,   18,   18,   24,   25,   18,   26,
-       18,   18,   27,   18,    4,   28,   29,   18,   30,   31,
-       18,   32,   33,   18,   18,   34,   35,   18,   36,   18,
-       18,   37,   18,   43,   44,   56,   57,   66,   67,   40,
-       40,   46,  111,  111,  110,  109,  107,  108,  107,  106,
-      103,  105,  101,  104,  103,  102,  101,  100,   95,   99,
-       98,   92,   91,   97,   89,   88,   96,   95,   94,   93,
-       92,   91,   90,   89,   88,   87,   86,   85,   84,   83,
-
-       82,   81,   80,   79,   78,   68,   77,   76,   75,   74,
-       73,   72,   71,   70,   69,   68,   42,   41,   38,   65,
-       64,   53,   63,   62,   61,   60,   59,   58,   55,   54,
-       53,   52,   51,   50,   49,   48,   47,   45,   42,   42,
-       41,   39,   38,  112,    3,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+         3,     4,     5,     6,     7,     8,     9,    10,    11,    12,
+        13,    14,    15,    16,    17,    18,    19,    20,    21,    20,
+        22,    23,    20,    24,    25,    20,    20,    26,    27,    20,
+        28,    20,    20,    29,    20,    20,    20,     4,    30,    31,
+        20,    32,    33,    20,    34,    35,    20,    20,    36,    37,
+        20,    38,    20,    20,    39,    20,    20,    20,     3,     3,
+        40,    48,    41,    42,    42,    42,    42,    43,    42,    42,
+        42,    42,    42,    42,    42,    42,    42,    42,    42,    42,
+        42,    42,    42,    42,    42,    42,    42,    42,    42,    42,
+        42,    42,    42,    42,    42,    42,    42,    42,    42,    42,
+
+        42,    42,    42,    42,    42,    42,    42,    42,    42,    42,
+        42,    42,    42,    42,    42,    42,    42,    42,    42,    42,
+         3,     3,    50,     3,    51,    52,    53,    54,    55,    56,
+        57,    44,    48,    48,    60,    45,    46,    47,    48,    48,
+        48,    48,    48,    48,    48,    48,    48,    48,    49,    48,
+        48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+        48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+        48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+        58,    59,    61,    62,    63,    64,    65,    55,    66,    67,
+        68,    69,    70,    72,    73,    71,    74,    75,    76,    77,
+
+        78,    79,    80,    81,    82,    71,    83,    84,    85,    86,
+        87,    88,    89,    90,    91,    92,    93,    94,    95,    96,
+        97,    98,    99,   100,   101,   102,    93,    94,   103,    96,
+        97,   104,   105,   100,   106,   107,   108,   109,   110,   111,
+       112,   108,   113,   110,   114,   115,   116,   117,   118,   116,
+       119,     3,   119,   121,     3,     0,     0,     0,     0,   120,
+         0,   122,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123
     } ;
 
-static yyconst flex_int16_t yy_chk[199] =
+static yyconst flex_int16_t yy_chk[321] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,   14,   14,   27,   27,   37,   37,  113,
-      113,  114,  110,  109,  108,  106,  105,  104,  102,  100,
-       99,   98,   97,   96,   94,   93,   90,   87,   86,   85,
-       84,   83,   82,   81,   80,   79,   78,   77,   76,   75,
-       74,   73,   72,   71,   70,   69,   67,   66,   65,   64,
-
-       63,   62,   61,   60,   59,   58,   57,   56,   55,   54,
-       52,   51,   50,   49,   48,   47,   42,   40,   38,   36,
-       35,   34,   33,   32,   31,   30,   29,   28,   26,   25,
-       24,   23,   22,   21,   20,   19,   17,   16,   12,   11,
-        8,    7,    5,    3,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+         1,     1,     1,     1,     1,     1,     1,     1,     5,     7,
+         5,    20,     7,     8,     8,     8,     8,     8,     8,     8,
+         8,     8,     8,     8,     8,     8,     8,     8,     8,     8,
+         8,     8,     8,     8,     8,     8,     8,     8,     8,     8,
+         8,     8,     8,     8,     8,     8,     8,     8,     8,     8,
+
+         8,     8,     8,     8,     8,     8,     8,     8,     8,     8,
+         8,     8,     8,     8,     8,     8,     8,     8,     8,     8,
+        13,    16,    21,    18,    22,    23,    24,    25,    26,    27,
+        28,    13,    19,    19,    30,    16,    16,    18,    19,    19,
+        19,    19,    19,    19,    19,    19,    19,    19,    19,    19,
+        19,    19,    19,    19,    19,    19,    19,    19,    19,    19,
+        19,    19,    19,    19,    19,    19,    19,    19,    19,    19,
+        19,    19,    19,    19,    19,    19,    19,    19,    19,    19,
+        29,    29,    31,    32,    33,    34,    35,    36,    37,    38,
+        39,    39,    49,    50,    51,    49,    52,    53,    54,    56,
+
+        57,    58,    59,    60,    61,    60,    62,    63,    64,    65,
+        66,    67,    68,    69,    70,    72,    73,    74,    75,    76,
+        77,    78,    79,    80,    81,    82,    83,    84,    85,    86,
+        87,    88,    89,    90,    91,    92,    95,    98,    99,   101,
+       102,   103,   104,   105,   106,   107,   109,   111,   112,   113,
+       114,   115,   117,   118,   120,     0,     0,     0,     0,   115,
+         0,   120,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123,
+       123,   123,   123,   123,   123,   123,   123,   123,   123,   123
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -570,7 +599,7 @@ char* strlower(char* s)
         }
 	return s;
 }
-#line 574 "lex.sql.c"
+#line 603 "lex.sql.c"
 
 #define INITIAL 0
 
@@ -760,7 +789,7 @@ YY_DECL
 #line 17 "SqlParser.l"
 
 
-#line 764 "lex.sql.c"
+#line 793 "lex.sql.c"
 
 	if ( !(yy_init) )
 		{
@@ -813,13 +842,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 113 )
+				if ( yy_current_state >= 124 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 145 );
+		while ( yy_base[yy_current_state] != 263 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -890,92 +919,112 @@ return COUNT;
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 29 "SqlParser.l"
-return AND;
+#line 28 "SqlParser.l"
+return ANALYZE;
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
 #line 30 "SqlParser.l"
-return OR;
+return AND;
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
 #line 31 "SqlParser.l"
-return EQUAL;
+return OR;
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
 #line 32 "SqlParser.l"
-return NEQUAL;
+return IN;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
 #line 33 "SqlParser.l"
-return GREATER;
+return EQUAL;
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
 #line 34 "SqlParser.l"
-return LESS;
+return NEQUAL;
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
 #line 35 "SqlParser.l"
-return GREATEREQUAL;
+return GREATER;
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
 #line 36 "SqlParser.l"
-return LESSEQUAL;
+return LESS;
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 38 "SqlParser.l"
-sqllval.string = strdup(sqltext); return INTEGER;
+#line 37 "SqlParser.l"
+return GREATEREQUAL;
 	YY_BREAK
 case 19:
-/* rule 19 can match eol */
 YY_RULE_SETUP
-#line 39 "SqlParser.l"
-sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+#line 38 "SqlParser.l"
+return LESSEQUAL;
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
 #line 40 "SqlParser.l"
-sqllval.string = strlower(strdup(sqltext)); return ID;
+sqllval.string = strdup(sqltext); return INTEGER;
 	YY_BREAK
 case 21:
+/* rule 21 can match eol */
 YY_RULE_SETUP
 #line 41 "SqlParser.l"
-return COMMA;
+sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
 #line 42 "SqlParser.l"
-return STAR;
+sqllval.string = strlower(strdup(sqltext)); return ID;
 	YY_BREAK
 case 23:
-/* rule 23 can match eol */
 YY_RULE_SETUP
 #line 43 "SqlParser.l"
-return LF;
+return COMMA;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
 #line 44 "SqlParser.l"
-/* ignore semicolon */
+return STAR;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
 #line 45 "SqlParser.l"
-/* ignore white space */
+return LPAREN;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
+#line 46 "SqlParser.l"
+return RPAREN;
+	YY_BREAK
+case 27:
+/* rule 27 can match eol */
+YY_RULE_SETUP
 #line 47 "SqlParser.l"
+return LF;
+	YY_BREAK
+case 28:
+YY_RULE_SETUP
+#line 48 "SqlParser.l"
+/* ignore semicolon */
+	YY_BREAK
+case 29:
+YY_RULE_SETUP
+#line 49 "SqlParser.l"
+/* ignore white space */
+	YY_BREAK
+case 30:
+YY_RULE_SETUP
+#line 51 "SqlParser.l"
 ECHO;
 	YY_BREAK
-#line 979 "lex.sql.c"
+#line 1028 "lex.sql.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1267,7 +1316,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 113 )
+			if ( yy_current_state >= 124 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1295,11 +1344,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 113 )
+		if ( yy_current_state >= 124 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 112);
+	yy_is_jam = (yy_current_state == 123);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }
@@ -1973,7 +2022,5 @@ void sqlfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 47 "SqlParser.l"
-
-
+#line 51 "SqlParser.l"
 
@@ -6,13 +6,63 @@
  * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
  * @date 3/24/2008
  */
- 
+
 #include "Bruinbase.h"
 #include "SqlEngine.h"
+#include "PageFile.h"
+#include "BTreeIndex.h"
+#include "ResultSink.h"
+#include "ParallelScan.h"
 #include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+static void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [-m cache_MB] [-r clock|lru2|2q] [-a readahead_pages] [-p page_bytes] [-f fill_percent] [-o text|csv|binary] [-t threads] [-M]\n", prog);
+  exit(1);
+}
 
-int main()
+int main(int argc, char* argv[])
 {
+  int opt;
+  BufferPool::Policy policy;
+  ResultSink::Format format;
+
+  // configure the buffer pool before any file is opened
+  while ((opt = getopt(argc, argv, "m:r:a:p:f:o:t:M")) != -1) {
+    switch (opt) {
+    case 'm':
+      if (PageFile::setCacheSize(atoi(optarg)) < 0) usage(argv[0]);
+      break;
+    case 'r':
+      if (BufferPool::parsePolicy(optarg, policy) < 0) usage(argv[0]);
+      if (PageFile::setCachePolicy(policy) < 0) usage(argv[0]);
+      break;
+    case 'a':
+      if (PageFile::setReadAhead(atoi(optarg)) < 0) usage(argv[0]);
+      break;
+    case 'p':
+      if (PageFile::setDefaultPageSize(atoi(optarg)) < 0) usage(argv[0]);
+      break;
+    case 'f':
+      if (BTreeIndex::setFillFactor(atoi(optarg)) < 0) usage(argv[0]);
+      break;
+    case 'o':
+      if (ResultSink::parseFormat(optarg, format) < 0) usage(argv[0]);
+      if (ResultSink::setFormat(format) < 0) usage(argv[0]);
+      break;
+    case 't':
+      if (ParallelScan::setThreadCount(atoi(optarg)) < 0) usage(argv[0]);
+      break;
+    case 'M':
+      if (SqlEngine::setMappedReads(true) < 0) usage(argv[0]);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
   // run the SQL engine taking user commands from standard input (console).
   SqlEngine::run(stdin);
 
@@ -8,3 +8,75 @@ rm -f xlarge.tbl xlarge.idx
 
 ./bruinbase < test.sql
 
+
+# an index scan fetches its rows through the asynchronous I/O engine
+rm -f asyncio.tbl asyncio.idx asyncio.sts
+echo "LOAD asyncio FROM 'movie.del' WITH INDEX" | ./bruinbase > /dev/null 2>&1
+if echo "SELECT * FROM asyncio WHERE key > 1000 AND key < 1100" | ./bruinbase 2>&1 > /dev/null | grep -q ", [1-9][0-9]* asynchronously"; then
+  echo "async I/O: ok"
+else
+  echo "async I/O: FAILED"
+  exit 1
+fi
+rm -f asyncio.tbl asyncio.idx asyncio.sts
+
+# an IN list looked up in the index returns every entry of a duplicated key
+rm -f inlist.tbl inlist.idx inlist.sts
+printf "LOAD inlist FROM 'movie.del' WITH INDEX\nLOAD inlist FROM 'movie.del' WITH INDEX\n" | ./bruinbase > /dev/null 2>&1
+if [ "`echo "SELECT key FROM inlist WHERE key IN (272, 3, 5000000)" | ./bruinbase 2> /dev/null | grep -cw "272\|3"`" = 4 ]; then
+  echo "IN lookup: ok"
+else
+  echo "IN lookup: FAILED"
+  exit 1
+fi
+rm -f inlist.tbl inlist.idx inlist.sts
+
+# parentheses group the conditions ANDed inside an OR
+rm -f paren.tbl paren.idx paren.sts
+echo "LOAD paren FROM 'movie.del' WITH INDEX" | ./bruinbase > /dev/null 2>&1
+if [ "`echo "SELECT key FROM paren WHERE (key > 5 AND value = '100 Kilos') OR (key < 3)" | ./bruinbase 2> /dev/null | grep -cw "2\|6"`" = 2 ]; then
+  echo "parentheses: ok"
+else
+  echo "parentheses: FAILED"
+  exit 1
+fi
+rm -f paren.tbl paren.idx paren.sts
+
+# COUNT(*) comes from the entry count of the index, also after a second
+# load has inserted into the existing index one entry at a time
+rm -f reload.tbl reload.idx reload.sts
+printf "LOAD reload FROM 'movie.del' WITH INDEX\nLOAD reload FROM 'movie.del' WITH INDEX\n" | ./bruinbase > /dev/null 2>&1
+if [ "`printf "SELECT COUNT(*) FROM reload\nSELECT COUNT(*) FROM reload WHERE key > 100 AND key < 2000\n" | ./bruinbase 2> /dev/null | grep -o "[0-9][0-9]*" | tr '\n' ' '`" = "7232 2936 " ]; then
+  echo "reload count: ok"
+else
+  echo "reload count: FAILED"
+  exit 1
+fi
+rm -f reload.tbl reload.idx reload.sts
+
+# COUNT(*) over key ranges is counted from the subtree sizes. the index is
+# built with small, half full pages so that it has several levels
+rm -f ranges.tbl ranges.idx ranges.sts
+echo "LOAD ranges FROM 'movie.del' WITH INDEX" | ./bruinbase -p 1024 -f 50 > /dev/null 2>&1
+if [ "`printf "SELECT COUNT(*) FROM ranges\nSELECT COUNT(*) FROM ranges WHERE key > 100 AND key < 2000\nSELECT COUNT(*) FROM ranges WHERE key >= 272 AND key <= 272\nSELECT COUNT(*) FROM ranges WHERE key < 0\nSELECT COUNT(*) FROM ranges WHERE key > 4000\n" | ./bruinbase 2> /dev/null | grep -o "[0-9][0-9]*" | tr '\n' ' '`" = "3616 1468 1 0 548 " ]; then
+  echo "range count: ok"
+else
+  echo "range count: FAILED"
+  exit 1
+fi
+rm -f ranges.tbl ranges.idx ranges.sts
+
+# the statistics LOAD saves are read back by SELECT, which then reads
+# fewer pages than when it collects them from the index itself
+rm -f stats.tbl stats.idx stats.sts
+echo "LOAD stats FROM 'movie.del' WITH INDEX" | ./bruinbase > /dev/null 2>&1
+saved=`echo "SELECT COUNT(*) FROM stats WHERE key > 100 AND key < 2000" | ./bruinbase 2>&1 | grep -o "Read [0-9]*" | grep -o "[0-9]*"`
+rm -f stats.sts
+collected=`echo "SELECT COUNT(*) FROM stats WHERE key > 100 AND key < 2000" | ./bruinbase 2>&1 | grep -o "Read [0-9]*" | grep -o "[0-9]*"`
+if [ -n "$saved" ] && [ -n "$collected" ] && [ "$saved" -lt "$collected" ]; then
+  echo "saved statistics: ok"
+else
+  echo "saved statistics: FAILED"
+  exit 1
+fi
+rm -f stats.tbl stats.idx stats.sts